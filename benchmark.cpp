@@ -0,0 +1,188 @@
+// Copyright 2018 Dennis Nienhüser
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "counters.h"
+#include "memory.h"
+#include "puzzle.h"
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+struct Case {
+    string name;
+    string stones;
+};
+
+// Outcome of running one case
+struct Measurement {
+    size_t layouts = 0;
+    size_t solutions = 0;
+    uint64_t nodes = 0;
+    double layoutSeconds = 0;
+    double solveSeconds = 0;
+    // Allocations while iterating from one solution to the next, which should not need any
+    uint64_t hotAllocations = 0;
+    Counters::Values layoutCounters;
+    Counters::Values solveCounters;
+};
+
+// Counts hardware events around the phases if counters are given
+static Measurement run(const Stones &stones, Counters *counters)
+{
+    using Time = chrono::steady_clock;
+    Measurement result;
+
+    if (counters) {
+        counters->start();
+    }
+    auto start = Time::now();
+    auto const layouts = LayoutGenerator::findAll(stones);
+    result.layoutSeconds = chrono::duration<double>(Time::now() - start).count();
+    if (counters) {
+        result.layoutCounters = counters->stop();
+    }
+    result.layouts = layouts.size();
+
+    if (counters) {
+        counters->start();
+    }
+    start = Time::now();
+    for (auto const &layout : layouts) {
+        SolutionIterator iterator(layout, stones);
+        auto const before = Memory::allocations();
+        for (; !iterator.atEnd(); iterator.next()) {
+            result.solutions += iterator.choices().empty() ? 0 : 1;
+        }
+        result.hotAllocations += Memory::allocations() - before;
+        result.nodes += iterator.nodes();
+    }
+    result.solveSeconds = chrono::duration<double>(Time::now() - start).count();
+    if (counters) {
+        result.solveCounters = counters->stop();
+    }
+    return result;
+}
+
+// Prints a ratio with the given precision, or a dash if it was not measured
+static void printRatio(double value, int width, int precision)
+{
+    if (value < 0) {
+        printf(" %*s", width, "-");
+    } else {
+        printf(" %*.*f", width, precision, value);
+    }
+}
+
+static void printCounters(const string &name, const char *phase, const Counters::Values &values, uint64_t nodes)
+{
+    printf("%-12s %-7s", name.c_str(), phase);
+    for (int event = Counters::Cycles; event <= Counters::Instructions; ++event) {
+        if (values.measured[event]) {
+            printf(" %12.3g", double(values.counts[event]));
+        } else {
+            printf(" %12s", "-");
+        }
+    }
+    printRatio(values.ratio(Counters::Instructions, Counters::Cycles), 5, 2);
+    for (auto const event : {Counters::Instructions, Counters::L1Misses, Counters::LLCMisses, Counters::BranchMisses}) {
+        printRatio(values.per(event, nodes), 12, event == Counters::Instructions ? 1 : 3);
+    }
+    printf("\n");
+}
+
+int main(int argc, char* argv[])
+{
+    vector<Case> const cases = {
+        {"five-colors", "DRB RDG GYR YBD BGY BGD RDY YR GB"},
+        {"5x5-48", "DR GB BYR YDG RGY BGY DYR DRB GBD"},
+        {"6x6-mixed", "GR YV RB DYV BGR VDY BDG YDV RGB VGDB YBVR DRYG"},
+        {"6x6-threes", "BDG YRV DGY RVB GYR VBD YRV BDG RVB DGY VBD GYR"}
+    };
+
+    vector<string> selected;
+    unique_ptr<Counters> counters;
+    for (int i = 1; i < argc; ++i) {
+        if (string(argv[i]) == "--counters") {
+            counters.reset(new Counters);
+        } else {
+            selected.push_back(argv[i]);
+        }
+    }
+    if (!Memory::tracked()) {
+        cout << "Allocation tracking is disabled, build with FIVE_COLORS_ALLOCATION_TRACKING to check hot paths.\n";
+    }
+    if (counters && !counters->available()) {
+        cout << "Hardware counters are not available (" << counters->error() << "), measuring time only.\n";
+        counters.reset();
+    }
+    vector<pair<string, Measurement>> measurements;
+    printf("%-12s %8s %10s %12s %10s %10s %12s %8s\n", "case", "layouts", "solutions", "placements",
+           "layout ms", "solve ms", "placements/s", "allocs");
+    bool failed = false;
+    for (auto const &benchmark : cases) {
+        if (!selected.empty() && find(selected.begin(), selected.end(), benchmark.name) == selected.end()) {
+            continue;
+        }
+        Stones stones;
+        size_t begin = 0;
+        while (begin < benchmark.stones.size()) {
+            auto end = benchmark.stones.find(' ', begin);
+            end = end == string::npos ? benchmark.stones.size() : end;
+            stones << benchmark.stones.substr(begin, end - begin);
+            begin = end + 1;
+        }
+
+        auto const result = run(stones, counters.get());
+        measurements.push_back({benchmark.name, result});
+        printf("%-12s %8zu %10zu %12llu %10.1f %10.1f %12.3g %8llu\n", benchmark.name.c_str(), result.layouts,
+               result.solutions, (unsigned long long)result.nodes, 1000 * result.layoutSeconds,
+               1000 * result.solveSeconds, result.nodes / max(1e-9, result.solveSeconds),
+               (unsigned long long)result.hotAllocations);
+        if (Memory::tracked() && result.hotAllocations > 0) {
+            cout << benchmark.name << ": Searching for the next solution must not allocate memory." << endl;
+            failed = true;
+        }
+    }
+
+    if (counters) {
+        // Placements are the nodes of the search, the layout phase has no such unit
+        printf("\n%-12s %-7s %12s %12s %5s %12s %12s %12s %12s\n", "case", "phase", "cycles", "instructions", "IPC",
+               "instr/place", "L1/place", "LLC/place", "branch/place");
+        for (auto const &measurement : measurements) {
+            printCounters(measurement.first, "layouts", measurement.second.layoutCounters, 0);
+            printCounters(measurement.first, "solve", measurement.second.solveCounters, measurement.second.nodes);
+        }
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,340 @@
+// Copyright 2018 Dennis Nienhüser
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef BUILTIN_H
+#define BUILTIN_H
+
+#include "puzzle.h"
+
+#include <cstddef>
+#include <cstdint>
+
+// A solver for puzzles known at compile time. It works on fixed-size arrays without allocating, such that
+// it can run in constant expressions: Puzzles built into the programs are solved while compiling them and
+// checked with static_assert. It does not separate layouts from the assignment of stones, but fills the
+// cells in row-major order directly. The first empty cell is always where the stone covering it begins.
+// Only solutions with the smallest board among its rotations and reflections are reported. Note that Solver
+// counts differently: It keeps one layout of each group of rotated and reflected ones and counts all
+// assignments of stones to it, such that a symmetric layout gives rotated boards more than once. The two
+// counts of a puzzle generally differ and cannot be compared.
+template <size_t Size, size_t Count>
+class BuiltinSolver
+{
+public:
+    struct Placement {
+        size_t stone = 0;
+        size_t row = 0;
+        size_t col = 0;
+        bool horizontal = true;
+        bool reverse = false;
+    };
+
+    struct Result {
+        // Number of solutions with a smallest board, which is not what Solver counts
+        size_t count = 0;
+        // The first of them
+        Placement placements[Count] = {};
+        // Row by row, terminated such that it can be spelled as a string literal
+        char cells[Size * Size + 1] = {};
+
+        constexpr char at(size_t row, size_t col) const
+        {
+            return cells[row * Size + col];
+        }
+    };
+
+    constexpr explicit BuiltinSolver(const char * const (&values)[Count])
+    {
+        size_t colors = 0;
+        size_t area = 0;
+        feasible_ = true;
+        for (size_t i = 0; i < Count; ++i) {
+            while (values[i][sizes_[i]] != '\0') {
+                if (sizes_[i] == Size) {
+                    feasible_ = false;
+                    break;
+                }
+                auto const symbol = values[i][sizes_[i]];
+                size_t id = 0;
+                while (id < colors && symbols_[id] != symbol) {
+                    ++id;
+                }
+                if (id == colors) {
+                    if (colors == Size) {
+                        feasible_ = false;
+                        break;
+                    }
+                    symbols_[colors++] = symbol;
+                }
+                fields_[i][sizes_[i]++] = symbol;
+                masks_[i][sizes_[i] - 1] = uint64_t(1) << id;
+            }
+            area += sizes_[i];
+            palindrome_[i] = true;
+            for (size_t k = 0; k < sizes_[i] / 2; ++k) {
+                palindrome_[i] = palindrome_[i] && fields_[i][k] == fields_[i][sizes_[i] - 1 - k];
+            }
+            previous_[i] = Count;
+            for (size_t j = 0; j < i; ++j) {
+                if (equal(i, j)) {
+                    previous_[i] = j;
+                }
+            }
+        }
+        feasible_ = feasible_ && area == Size * Size;
+    }
+
+    // Calls back with the state of each solution. Returns the number of solutions.
+    template <typename Callback>
+    constexpr size_t forEach(Callback && callback) const
+    {
+        State state;
+        size_t count = 0;
+        if (feasible_) {
+            search(state, 0, 0, callback, count);
+        }
+        return count;
+    }
+
+    constexpr Result solve() const
+    {
+        Result result;
+        First first = {&result, false};
+        result.count = forEach(first);
+        return result;
+    }
+
+    // True if the placements of the result use each stone once, give the cells of the result and the
+    // cells are the smallest board among its rotations and reflections. Unlike solve(), this is cheap
+    // enough for constant expressions on any board.
+    constexpr bool verify(const Result & result) const
+    {
+        State state;
+        for (auto const &placement : result.placements) {
+            if (!feasible_ || placement.stone >= Count || state.used[placement.stone] ||
+                placement.row >= Size || placement.col >= Size || !fits(state, placement)) {
+                return false;
+            }
+            assign(state, placement, true);
+        }
+        for (size_t i = 0; i < Size * Size; ++i) {
+            if (state.cells[i] != result.cells[i]) {
+                return false;
+            }
+        }
+        return isCanonical(state);
+    }
+
+    // The placements of a result in terms of the runtime solver
+    Solution solution(const Result & result) const
+    {
+        Solution solution;
+        for (auto const &placement : result.placements) {
+            auto const stone = placement.stone;
+            solution.push_back({{sizes_[stone], placement.row, placement.col, placement.horizontal, placement.reverse},
+                                Stone(std::string(fields_[stone], sizes_[stone]))});
+        }
+        return solution;
+    }
+
+    struct State {
+        Placement placements[Count] = {};
+        bool used[Count] = {};
+        char cells[Size * Size] = {};
+        uint64_t rows[Size] = {};
+        uint64_t cols[Size] = {};
+        size_t placed = 0;
+    };
+
+private:
+    // Keeps the first solution. Lambdas cannot be called in constant expressions before C++17.
+    struct First {
+        Result *result;
+        bool found;
+
+        constexpr void operator()(const State & state)
+        {
+            if (found) {
+                return;
+            }
+            found = true;
+            for (size_t i = 0; i < Count; ++i) {
+                result->placements[i] = state.placements[i];
+            }
+            for (size_t i = 0; i < Size * Size; ++i) {
+                result->cells[i] = state.cells[i];
+            }
+        }
+    };
+
+    constexpr bool equal(size_t a, size_t b) const
+    {
+        if (sizes_[a] != sizes_[b]) {
+            return false;
+        }
+        for (size_t k = 0; k < sizes_[a]; ++k) {
+            if (fields_[a][k] != fields_[b][k]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    constexpr bool fits(const State & state, const Placement & placement) const
+    {
+        auto const size = sizes_[placement.stone];
+        if ((placement.horizontal ? placement.col : placement.row) + size > Size) {
+            return false;
+        }
+        for (size_t k = 0; k < size; ++k) {
+            auto const row = placement.horizontal ? placement.row : placement.row + k;
+            auto const col = placement.horizontal ? placement.col + k : placement.col;
+            auto const mask = masks_[placement.stone][placement.reverse ? size - 1 - k : k];
+            if (state.cells[row * Size + col] != '\0' || ((state.rows[row] | state.cols[col]) & mask)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    constexpr void assign(State & state, const Placement & placement, bool add) const
+    {
+        auto const size = sizes_[placement.stone];
+        for (size_t k = 0; k < size; ++k) {
+            auto const row = placement.horizontal ? placement.row : placement.row + k;
+            auto const col = placement.horizontal ? placement.col + k : placement.col;
+            auto const field = placement.reverse ? size - 1 - k : k;
+            state.cells[row * Size + col] = add ? fields_[placement.stone][field] : '\0';
+            state.rows[row] ^= masks_[placement.stone][field];
+            state.cols[col] ^= masks_[placement.stone][field];
+        }
+        state.used[placement.stone] = add;
+        if (add) {
+            state.placements[state.placed++] = placement;
+        } else {
+            --state.placed;
+        }
+    }
+
+    // True if no rotation or reflection of the board is smaller
+    static constexpr bool isCanonical(const State & state)
+    {
+        auto const last = Size - 1;
+        for (int variant = 1; variant < 8; ++variant) {
+            for (size_t i = 0; i < Size * Size; ++i) {
+                auto row = i / Size;
+                auto col = i % Size;
+                if (variant & 1) {
+                    col = last - col;
+                }
+                if (variant & 2) {
+                    row = last - row;
+                }
+                if (variant & 4) {
+                    auto const swapped = row;
+                    row = col;
+                    col = swapped;
+                }
+                auto const cell = state.cells[row * Size + col];
+                if (cell != state.cells[i]) {
+                    if (cell < state.cells[i]) {
+                        return false;
+                    }
+                    break;
+                }
+            }
+        }
+        return true;
+    }
+
+    // False if a rotation or reflection is known to have a smaller board already. The corners are the first
+    // cells of the rotated and mirrored boards. The transposed board keeps the first cell and starts its
+    // second one below it.
+    static constexpr bool mayBeCanonical(const State & state)
+    {
+        auto const first = state.cells[0];
+        for (auto const corner : {Size - 1, (Size - 1) * Size, Size * Size - 1}) {
+            auto const cell = state.cells[corner];
+            if (cell != '\0' && cell < first) {
+                return false;
+            }
+        }
+        return state.cells[1] == '\0' || state.cells[Size] == '\0' || state.cells[1] <= state.cells[Size];
+    }
+
+    template <typename Callback>
+    constexpr void search(State & state, size_t row, size_t col, Callback & callback, size_t & count) const
+    {
+        while (row < Size && state.cells[row * Size + col] != '\0') {
+            if (++col == Size) {
+                col = 0;
+                ++row;
+            }
+        }
+        if (row == Size) {
+            if (isCanonical(state)) {
+                ++count;
+                callback(state);
+            }
+            return;
+        }
+        auto const blocked = state.rows[row] | state.cols[col];
+        for (size_t stone = 0; stone < Count; ++stone) {
+            // Equal stones are placed in order
+            if (state.used[stone] || (previous_[stone] < Count && !state.used[previous_[stone]])) {
+                continue;
+            }
+            auto const size = sizes_[stone];
+            for (int orientation = 0; orientation < 4; ++orientation) {
+                Placement const placement = {stone, row, col, orientation < 2, (orientation & 1) == 1};
+                if ((!placement.horizontal && size == 1) || (placement.reverse && palindrome_[stone]) ||
+                    (blocked & masks_[stone][placement.reverse ? size - 1 : 0])) {
+                    continue;
+                }
+                if (fits(state, placement)) {
+                    assign(state, placement, true);
+                    if (mayBeCanonical(state)) {
+                        search(state, row, col, callback, count);
+                    }
+                    assign(state, placement, false);
+                }
+            }
+        }
+    }
+
+    char fields_[Count][Size] = {};
+    uint64_t masks_[Count][Size] = {};
+    size_t sizes_[Count] = {};
+    bool palindrome_[Count] = {};
+    // The closest earlier stone with the same colors, or Count
+    size_t previous_[Count] = {};
+    char symbols_[Size] = {};
+    bool feasible_ = false;
+};
+
+#endif
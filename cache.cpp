@@ -0,0 +1,342 @@
+// Copyright 2018 Dennis Nienhüser
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "cache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+
+using namespace std;
+
+static string const magic = "five-colors-cache";
+static int const version = 1;
+// Renamings tried at most for the canonical form, as many as for seven colors that cannot be told apart
+static uint64_t const maxRenamings = 5040;
+
+// The smaller of the two directions of a stone
+static string oriented(const string &value)
+{
+    return min(value, string(value.rbegin(), value.rend()));
+}
+
+// Moves on to the next renaming, permuting the colors within each group like the digits of a counter
+static bool nextRenaming(vector<char> &order, const vector<size_t> &groups)
+{
+    for (size_t group = groups.size() - 1; group-- > 0; ) {
+        auto const begin = order.begin() + long(groups[group]);
+        auto const end = order.begin() + long(groups[group + 1]);
+        if (next_permutation(begin, end)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+CanonicalStones::CanonicalStones(const Stones &stones)
+{
+    canonical_.fill(0);
+    original_.fill(0);
+    vector<string> values;
+    for (auto const &stone : stones) {
+        values.emplace_back(stone.fields.begin(), stone.fields.end());
+        stones_.insert(values.back());
+    }
+
+    // Renaming colors keeps the sizes of the stones they occur in and their distances to the stone ends
+    map<char, vector<pair<size_t, size_t>>> occurrences;
+    for (auto const &value : values) {
+        for (size_t i = 0, n = value.size(); i < n; ++i) {
+            occurrences[value[i]].push_back({n, min(i, n - 1 - i)});
+        }
+    }
+    vector<pair<vector<pair<size_t, size_t>>, char>> colors;
+    for (auto &occurrence : occurrences) {
+        sort(occurrence.second.begin(), occurrence.second.end());
+        colors.push_back({occurrence.second, occurrence.first});
+    }
+    sort(colors.begin(), colors.end());
+
+    // Only colors with the same occurrences are swapped
+    vector<char> order;
+    vector<size_t> groups;
+    uint64_t renamings = 1;
+    for (size_t i = 0; i < colors.size(); ++i) {
+        if (i == 0 || colors[i].first != colors[i - 1].first) {
+            groups.push_back(i);
+        }
+        order.push_back(colors[i].second);
+        renamings = min(maxRenamings + 1, renamings * (i + 1 - groups.back()));
+    }
+    groups.push_back(colors.size());
+
+    string const &symbols = Palette::symbols();
+    vector<char> best;
+    do {
+        array<char, 256> renamed;
+        for (size_t i = 0; i < order.size(); ++i) {
+            renamed[uint8_t(order[i])] = symbols[i];
+        }
+        vector<string> canonical;
+        for (auto const &value : values) {
+            string stone;
+            for (auto const symbol : value) {
+                stone.push_back(renamed[uint8_t(symbol)]);
+            }
+            canonical.push_back(oriented(stone));
+        }
+        sort(canonical.begin(), canonical.end());
+        string key;
+        for (auto const &stone : canonical) {
+            key += (key.empty() ? "" : " ") + stone;
+        }
+        if (best.empty() || key < key_) {
+            key_ = key;
+            best = order;
+        }
+    } while (renamings <= maxRenamings && nextRenaming(order, groups));
+
+    for (size_t i = 0; i < best.size(); ++i) {
+        canonical_[uint8_t(best[i])] = symbols[i];
+        original_[uint8_t(symbols[i])] = best[i];
+    }
+    istringstream tokens(key_);
+    for (string stone; tokens >> stone; ) {
+        canonicalStones_.insert(stone);
+    }
+}
+
+string const &CanonicalStones::key() const
+{
+    return key_;
+}
+
+Solution CanonicalStones::toCanonical(const Solution &solution) const
+{
+    return translate(solution, canonical_, canonicalStones_);
+}
+
+Solution CanonicalStones::fromCanonical(const Solution &solution) const
+{
+    return translate(solution, original_, stones_);
+}
+
+Solution CanonicalStones::translate(const Solution &solution, const array<char, 256> &colors,
+                                    const set<string> &stones) const
+{
+    Solution result;
+    for (auto const &placement : solution) {
+        auto position = placement.first;
+        string value;
+        for (auto const symbol : placement.second.fields) {
+            value.push_back(colors[uint8_t(symbol)]);
+        }
+        if (!stones.count(value)) {
+            // The stone exists in the other direction only, which covers the same cells placed reversed
+            reverse(value.begin(), value.end());
+            position.reverse = !position.reverse;
+        }
+        result.push_back({position, Stone(value)});
+    }
+    return result;
+}
+
+// Reads the stones of a canonical puzzle and the size of its board
+static bool parsePuzzle(const string &key, multiset<string> &values, size_t &size)
+{
+    Stones stones;
+    istringstream tokens(key);
+    for (string stone; tokens >> stone; ) {
+        if (stone.size() > Stone::maxSize || !Palette::contains(stone)) {
+            return false;
+        }
+        stones << stone;
+        values.insert(stone);
+    }
+    vector<size_t> sizes;
+    if (stones.empty() || !LayoutGenerator::sizes(stones, sizes)) {
+        return false;
+    }
+    size = sizes.size() - 1;
+    return true;
+}
+
+// Whether the solution places each stone once, within the board and with no color twice in a row or column
+static bool isSolution(const Solution &solution, multiset<string> stones, size_t size)
+{
+    Board board(size);
+    for (auto const &placement : solution) {
+        auto const stone = stones.find(placement.second.value());
+        if (stone == stones.end() || !board.canAssign(placement.first, placement.second)) {
+            return false;
+        }
+        stones.erase(stone);
+        board.assign(placement.first, placement.second);
+    }
+    return stones.empty() && board.isValid() && board.isFull();
+}
+
+ResultCache::ResultCache(const string &filename) : filename_(filename)
+{
+    if (!filename_.empty() && !load()) {
+        // Searching again is always possible, so a damaged file is the same as an empty one
+        results_.clear();
+    }
+}
+
+string const &ResultCache::error() const
+{
+    return error_;
+}
+
+bool ResultCache::find(const CanonicalStones &puzzle, size_t &count, Solutions &solutions, size_t limit) const
+{
+    lock_guard<mutex> guard(lock_);
+    auto const cached = results_.find(puzzle.key());
+    if (cached == results_.end()) {
+        return false;
+    }
+    count = cached->second.size();
+    solutions.clear();
+    for (auto solution = cached->second.begin(); solution != cached->second.end() && limit > 0; ++solution, --limit) {
+        solutions.push_back(puzzle.fromCanonical(*solution));
+    }
+    return true;
+}
+
+void ResultCache::insert(const CanonicalStones &puzzle, const Solutions &solutions)
+{
+    if (solutions.size() > maxSolutions) {
+        return;
+    }
+    Solutions canonical;
+    for (auto const &solution : solutions) {
+        canonical.push_back(puzzle.toCanonical(solution));
+    }
+    lock_guard<mutex> guard(lock_);
+    results_[puzzle.key()] = canonical;
+}
+
+size_t ResultCache::size() const
+{
+    lock_guard<mutex> guard(lock_);
+    return results_.size();
+}
+
+bool ResultCache::save() const
+{
+    lock_guard<mutex> guard(lock_);
+    string const temporary = filename_ + ".tmp";
+    {
+        ofstream file(temporary);
+        if (!file) {
+            return false;
+        }
+        file << magic << ' ' << version << '\n';
+        for (auto const &result : results_) {
+            file << "puzzle " << result.first << '\n';
+            file << "solutions " << result.second.size() << '\n';
+            for (auto const &solution : result.second) {
+                file << solution.size();
+                for (auto const &placement : solution) {
+                    auto const &position = placement.first;
+                    file << ' ' << position.row << ' ' << position.col << ' ' << position.horizontal << ' '
+                         << position.reverse << ' ' << placement.second.value();
+                }
+                file << '\n';
+            }
+        }
+        file.flush();
+        if (!file) {
+            return false;
+        }
+    }
+    return rename(temporary.c_str(), filename_.c_str()) == 0;
+}
+
+bool ResultCache::load()
+{
+    ifstream file(filename_);
+    if (!file) {
+        // Nothing cached yet
+        return true;
+    }
+    string key;
+    int fileVersion = 0;
+    if (!(file >> key >> fileVersion) || key != magic || fileVersion != version) {
+        error_ = "Cache file '" + filename_ + "' has an unknown format.";
+        return false;
+    }
+    string line;
+    getline(file, line);
+    while (getline(file, line)) {
+        if (line.compare(0, 7, "puzzle ") != 0) {
+            error_ = "Cache file '" + filename_ + "' is damaged.";
+            return false;
+        }
+        auto const puzzle = line.substr(7);
+        auto &solutions = results_[puzzle];
+        multiset<string> stones;
+        size_t size = 0;
+        size_t count = 0;
+        if (!parsePuzzle(puzzle, stones, size) || !(file >> key >> count) || key != "solutions" ||
+            count > maxSolutions) {
+            error_ = "Cache file '" + filename_ + "' is damaged.";
+            return false;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            Solution solution;
+            size_t placements = 0;
+            if (!(file >> placements)) {
+                error_ = "Cache file '" + filename_ + "' is damaged.";
+                return false;
+            }
+            for (size_t k = 0; k < placements; ++k) {
+                Position position;
+                string stone;
+                if (!(file >> position.row >> position.col >> position.horizontal >> position.reverse >> stone) ||
+                    stone.empty() || stone.size() > Stone::maxSize || !Palette::contains(stone)) {
+                    error_ = "Cache file '" + filename_ + "' is damaged.";
+                    return false;
+                }
+                position.size = stone.size();
+                solution.push_back({position, Stone(stone)});
+            }
+            if (!isSolution(solution, stones, size)) {
+                error_ = "Cache file '" + filename_ + "' contains a wrong solution of " + puzzle + ".";
+                return false;
+            }
+            solutions.push_back(solution);
+        }
+        getline(file, line);
+    }
+    return true;
+}
@@ -0,0 +1,103 @@
+// Copyright 2018 Dennis Nienhüser
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include "puzzle.h"
+
+#include <array>
+#include <limits>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Canonical form of a puzzle. Puzzles whose stones differ only in the names of their colors, in their order or
+// in their direction share it. Colors are renamed such that the sorted stones, each in its smaller direction,
+// are smallest. Colors that occur at different places in the stones are never swapped for that, which keeps
+// the renamings to try few. If there are still too many, colors are only renamed in the order of their
+// symbols, and puzzles with swapped color names get different canonical forms.
+class CanonicalStones
+{
+public:
+    explicit CanonicalStones(const Stones & stones);
+
+    // The canonical stones, separated by spaces
+    std::string const & key() const;
+    // Renames and turns the stones of a solution of the stones given into a canonical one
+    Solution toCanonical(const Solution & solution) const;
+    // The other way round, using the stones given
+    Solution fromCanonical(const Solution & solution) const;
+
+private:
+    Solution translate(const Solution & solution, const std::array<char, 256> & colors,
+                       const std::set<std::string> & stones) const;
+
+    std::string key_;
+    // Canonical symbol of each symbol given, and the other way round
+    std::array<char, 256> canonical_;
+    std::array<char, 256> original_;
+    std::set<std::string> stones_;
+    std::set<std::string> canonicalStones_;
+};
+
+// Solutions of puzzles searched completely before, by their canonical form. Optionally kept in a file across
+// runs. Safe to use from several threads.
+class ResultCache
+{
+public:
+    // Puzzles with more solutions are not kept, as all of them are held in memory to do so
+    static constexpr size_t maxSolutions = 100000;
+
+    // Loads the results saved in the file, if there is one. A damaged file is ignored as a whole.
+    explicit ResultCache(const std::string & filename = std::string());
+
+    // Why the file could not be loaded, empty if it was or if there was none
+    std::string const & error() const;
+
+    // Whether the puzzle was solved before. Fills in the number of solutions if so, and translates the
+    // first solutions up to the limit to the stones given.
+    bool find(const CanonicalStones & puzzle, size_t & count, Solutions & solutions,
+              size_t limit = std::numeric_limits<size_t>::max()) const;
+    void insert(const CanonicalStones & puzzle, const Solutions & solutions);
+    size_t size() const;
+    // Writes all results to the file, replacing it atomically
+    bool save() const;
+
+private:
+    bool load();
+
+    std::string filename_;
+    std::string error_;
+    mutable std::mutex lock_;
+    std::unordered_map<std::string, Solutions> results_;
+};
+
+#endif
@@ -0,0 +1,78 @@
+// Copyright 2018 Dennis Nienhüser
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "checkpoint.h"
+#include "statefile.h"
+
+#include <fstream>
+
+using namespace std;
+
+static string const magic = "five-colors-checkpoint";
+static int const version = 2;
+
+bool Checkpoint::save(const string &filename) const
+{
+    return StateFile::save(filename, magic, version, stones, shard, [this](ostream &file) {
+        file << "max-nodes " << maxNodes << '\n';
+        file << "layout " << layout << '\n';
+        file << "solutions " << solutions << '\n';
+        file << "output " << output << '\n';
+        file << "path " << state.path.size();
+        for (auto const &choice : state.path) {
+            file << ' ' << choice.stone << ' ' << choice.reverse;
+        }
+        file << '\n';
+        file << "cursor " << state.cursor.stone << ' ' << state.cursor.reverse << '\n';
+    });
+}
+
+bool Checkpoint::load(const string &filename)
+{
+    ifstream file(filename);
+    if (!StateFile::load(file, magic, version, stones, shard)) {
+        return false;
+    }
+
+    string key;
+    size_t length = 0;
+    if (!(file >> key >> maxNodes) || key != "max-nodes" ||
+        !(file >> key >> layout) || key != "layout" ||
+        !(file >> key >> solutions) || key != "solutions" ||
+        !(file >> key >> output) || key != "output" ||
+        !(file >> key >> length) || key != "path" || length > stones.size()) {
+        return false;
+    }
+    state.path.resize(length);
+    for (auto &choice : state.path) {
+        if (!(file >> choice.stone >> choice.reverse)) {
+            return false;
+        }
+    }
+    return bool(file >> key >> state.cursor.stone >> state.cursor.reverse) && key == "cursor";
+}
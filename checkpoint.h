@@ -0,0 +1,62 @@
+// Copyright 2018 Dennis Nienhüser
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "puzzle.h"
+
+#include <limits>
+#include <string>
+#include <vector>
+
+// Progress of a search over all layouts of a set of stones. Saved to a file periodically, such that an
+// interrupted search can be resumed.
+struct Checkpoint {
+    // The stones searched for, in the order given
+    std::vector<std::string> stones;
+    // The part of the search space searched and the placements allowed per run. A resumed search needs the
+    // same, otherwise its counts differ from an uninterrupted one.
+    Shard shard;
+    uint64_t maxNodes = std::numeric_limits<uint64_t>::max();
+    // Index of the layout searched currently
+    size_t layout = 0;
+    // Solutions found so far, including those of the current layout
+    size_t solutions = 0;
+    // Size of the output file with the solutions found so far. A resumed search cuts off what was written
+    // after the checkpoint, as it finds those solutions again.
+    uint64_t output = 0;
+    // Search state within the current layout
+    SolutionIterator::State state;
+
+    // Writes the checkpoint to a temporary file first, such that an interruption never leaves a broken file
+    bool save(const std::string &filename) const;
+    bool load(const std::string &filename);
+};
+
+#endif
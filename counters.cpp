@@ -0,0 +1,184 @@
+// Copyright 2018 Dennis Nienhüser
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "counters.h"
+
+#ifdef __linux__
+#include <cerrno>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+double Counters::Values::ratio(Event event, Event other) const
+{
+    if (!measured[event] || !measured[other] || counts[other] == 0) {
+        return -1;
+    }
+    return double(counts[event]) / counts[other];
+}
+
+double Counters::Values::per(Event event, uint64_t units) const
+{
+    if (!measured[event] || units == 0) {
+        return -1;
+    }
+    return double(counts[event]) / units;
+}
+
+#ifdef __linux__
+
+static int openCounter(uint32_t type, uint64_t config)
+{
+    perf_event_attr attributes;
+    memset(&attributes, 0, sizeof(attributes));
+    attributes.size = sizeof(attributes);
+    attributes.type = type;
+    attributes.config = config;
+    attributes.disabled = 1;
+    attributes.exclude_kernel = 1;
+    attributes.exclude_hv = 1;
+    attributes.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return int(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+}
+
+Counters::Counters()
+{
+    uint64_t const l1Misses = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                              (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    descriptors_[Cycles] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    // The kernel tells best why counting is not possible when opening the first counter
+    if (descriptors_[Cycles] < 0) {
+        error_ = strerror(errno);
+        if (errno == EACCES || errno == EPERM) {
+            error_ += ", see /proc/sys/kernel/perf_event_paranoid";
+        } else if (errno == ENOENT || errno == EOPNOTSUPP) {
+            error_ += ", the CPU or virtual machine provides no hardware counters";
+        }
+    }
+    descriptors_[Instructions] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    descriptors_[L1Misses] = openCounter(PERF_TYPE_HW_CACHE, l1Misses);
+    descriptors_[LLCMisses] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+    descriptors_[BranchMisses] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+    if (available()) {
+        error_.clear();
+    } else if (error_.empty()) {
+        error_ = "No hardware counter can be opened";
+    }
+}
+
+Counters::~Counters()
+{
+    for (auto const descriptor : descriptors_) {
+        if (descriptor >= 0) {
+            close(descriptor);
+        }
+    }
+}
+
+void Counters::start()
+{
+    for (auto const descriptor : descriptors_) {
+        if (descriptor >= 0) {
+            ioctl(descriptor, PERF_EVENT_IOC_RESET, 0);
+            ioctl(descriptor, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+Counters::Values Counters::stop()
+{
+    for (auto const descriptor : descriptors_) {
+        if (descriptor >= 0) {
+            ioctl(descriptor, PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+    Values result;
+    for (int event = 0; event < Events; ++event) {
+        // Count, time enabled and time running
+        uint64_t values[3] = {};
+        if (descriptors_[event] < 0 || read(descriptors_[event], values, sizeof(values)) != sizeof(values) ||
+            values[2] == 0) {
+            continue;
+        }
+        result.counts[event] = values[2] < values[1] ? uint64_t(double(values[0]) * values[1] / values[2])
+                                                     : values[0];
+        result.measured[event] = true;
+    }
+    return result;
+}
+
+#else
+
+Counters::Counters() : error_("Hardware counters are only supported on Linux")
+{
+    for (auto &descriptor : descriptors_) {
+        descriptor = -1;
+    }
+}
+
+Counters::~Counters()
+{
+}
+
+void Counters::start()
+{
+}
+
+Counters::Values Counters::stop()
+{
+    return Values();
+}
+
+#endif
+
+bool Counters::available() const
+{
+    for (auto const descriptor : descriptors_) {
+        if (descriptor >= 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+string const &Counters::error() const
+{
+    return error_;
+}
+
+char const *Counters::name(Event event)
+{
+    static char const * const names[Events] = {"cycles", "instructions", "L1 misses", "LLC misses",
+                                               "branch misses"};
+    return names[event];
+}
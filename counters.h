@@ -0,0 +1,81 @@
+// Copyright 2018 Dennis Nienhüser
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef COUNTERS_H
+#define COUNTERS_H
+
+#include <cstdint>
+#include <string>
+
+// Hardware performance counters of the calling thread, read with perf_event_open on Linux. Only user
+// space is counted. Counters the CPU, the kernel or its settings do not provide are left out, and if none
+// can be opened at all, available() is false and error() tells why.
+class Counters
+{
+public:
+    enum Event {
+        Cycles,
+        Instructions,
+        L1Misses,
+        LLCMisses,
+        BranchMisses,
+        Events
+    };
+
+    struct Values {
+        uint64_t counts[Events] = {};
+        // False for events that could not be counted
+        bool measured[Events] = {};
+
+        // Quotient of two events, or a negative number if either was not measured
+        double ratio(Event event, Event other) const;
+        // Events per unit, e.g. per placement, or a negative number if not measured
+        double per(Event event, uint64_t units) const;
+    };
+
+    Counters();
+    ~Counters();
+    Counters(const Counters &) = delete;
+    Counters &operator=(const Counters &) = delete;
+
+    bool available() const;
+    std::string const & error() const;
+    static char const * name(Event event);
+
+    // Resets and enables the counters
+    void start();
+    // Disables the counters and returns their values since start(). Values are scaled up if the kernel had
+    // to multiplex the counters.
+    Values stop();
+
+private:
+    int descriptors_[Events];
+    std::string error_;
+};
+
+#endif
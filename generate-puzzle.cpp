@@ -26,6 +26,8 @@
 // ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
 // POSSIBILITY OF SUCH DAMAGE.
 
+#include "memory.h"
+#include "progress.h"
 #include "puzzle.h"
 
 #include <iostream>
@@ -33,24 +35,33 @@
 #include <random>
 #include <functional>
 #include <algorithm>
+#include <cassert>
+#include <limits>
+#include <memory>
 
 using namespace std;
 
-void swapRows(Board &board, size_t rowA, size_t rowB)
+// Counts the solutions of the stones in all layouts, but stops counting at the limit
+size_t countSolutions(Stones const &stones, Layouts const &layouts, size_t limit)
 {
-    for (size_t col = 0, n = board.size(); col < n; ++col) {
-        swap(board.at(rowA, col), board.at(rowB, col));
-    }
-}
-
-void swapCols(Board &board, size_t colA, size_t colB)
-{
-    for (size_t row = 0, n = board.size(); row < n; ++row) {
-        swap(board.at(row, colA), board.at(row, colB));
+    size_t count = 0;
+    LayoutFilter filter(stones);
+    for (auto const &layout : layouts) {
+        if (count >= limit) {
+            break;
+        }
+        if (filter.accepts(layout)) {
+            Solver const solver(layout, stones);
+            for (auto iterator = solver.begin(); !iterator.atEnd() && count < limit; iterator.next()) {
+                ++count;
+            }
+        }
     }
+    return count;
 }
 
-bool isNice(Solution const &solution, Layouts const & layouts, size_t &num_solutions)
+bool isNice(Solution const &solution, Layouts const & layouts, size_t &num_solutions,
+            size_t limit = numeric_limits<size_t>::max())
 {
     Stones stones;
     set<string> values;
@@ -62,19 +73,77 @@ bool isNice(Solution const &solution, Layouts const & layouts, size_t &num_solut
         return false;
     }
 
-    num_solutions = 0;
-    for (auto const &layout : layouts) {
-        num_solutions += Solver(layout, stones).findAssignment().size();
+    num_solutions = countSolutions(stones, layouts, limit);
+    return num_solutions > 0;
+}
+
+// Cuts the board into the stones of the layout
+Solution slice(Board const &board, Layout const &layout)
+{
+    Solution solution;
+    for (auto const &position : layout.positions()) {
+        size_t row = position.row;
+        size_t col = position.col;
+        string fields;
+        fields.reserve(position.size);
+        for (size_t i = 0, n = position.size; i < n; ++i) {
+            auto const value = board.at(row, col);
+            fields.push_back(value);
+            row += position.horizontal ? 0 : 1;
+            col += position.horizontal ? 1 : 0;
+        }
+        if (position.reverse) {
+            reverse(fields.begin(), fields.end());
+        }
+        Stone const stone(fields);
+        solution.push_back(make_pair(position, stone));
     }
+    return solution;
+}
 
-    return num_solutions > 0;
+// Hill climbing towards a puzzle with a single solution: Switching a cycle of two rows keeps the board valid but
+// changes the stones cut from it. A switch is kept unless it increases the number of solutions, which allows
+// sideways moves. Each candidate is counted only up to one more than the current number of solutions.
+size_t refine(Board &board, Layout const &layout, Layouts const &layouts, size_t solutions, size_t steps,
+              default_random_engine &generator)
+{
+    auto const size = board.size();
+    uniform_int_distribution<size_t> distribution(0, size - 1);
+    for (size_t step = 0; step < steps && solutions > 1; ++step) {
+        auto const rowA = distribution(generator);
+        auto const rowB = (rowA + 1 + distribution(generator) % (size - 1)) % size;
+        auto const col = distribution(generator);
+        board.switchCycle(rowA, rowB, col);
+        assert(board.isValid());
+        size_t count = 0;
+        if (isNice(slice(board, layout), layouts, count, solutions + 1) && count <= solutions) {
+            solutions = count;
+        } else {
+            // Switching the same cycle again restores the board
+            board.switchCycle(rowA, rowB, col);
+        }
+    }
+    return solutions;
 }
 
 int main(int argc, char* argv[])
 {
-    vector<size_t> stones(size_t(argc), 0);
-    for (size_t i = 1; i < size_t(argc); ++i) {
-        stones[i] = stoull(argv[i]);
+    bool mem_stats = false;
+    int progress_interval = 0;
+    size_t refine_steps = 10;
+    // Candidates with more solutions hardly ever get down to a single one within the steps
+    size_t const refine_limit = 4;
+    vector<size_t> stones(1, 0);
+    for (int i = 1; i < argc; ++i) {
+        if (string(argv[i]) == "--mem-stats") {
+            mem_stats = true;
+        } else if (string(argv[i]) == "--refine" && i + 1 < argc) {
+            refine_steps = stoull(argv[++i]);
+        } else if (string(argv[i]) == "--progress" && i + 1 < argc) {
+            progress_interval = stoi(argv[++i]);
+        } else {
+            stones.push_back(stoull(argv[i]));
+        }
     }
     if (stones.empty()) {
         cout << "Usage: " << argv[0] << " STONE1 STONE2 STONE3 ...\n";
@@ -82,12 +151,25 @@ int main(int argc, char* argv[])
         cout << "Pass e.g. GRB BGR RBG for a 3x3 board." << endl;
         return 0;
     }
+    if (stones.size() > Stone::maxSize + 1) {
+        cerr << "Stones are too long: " << stones.size() - 1 << " exceeds the maximum of " << Stone::maxSize << " colors." << endl;
+        return 1;
+    }
 
     auto const layouts = LayoutGenerator::findAll(stones);
-    string const colors = "BDGYRVOMPSTWCFIKL";
+    string const colors = Palette::symbols();
+    unique_ptr<Progress> progress;
+    if (progress_interval > 0) {
+        progress.reset(new Progress(layouts.size(), chrono::seconds(progress_interval)));
+    }
+    size_t puzzles = 0;
     for (auto const &layout : layouts) {
+        if (progress) {
+            progress->startLayout();
+            progress->update(0, puzzles);
+        }
         auto const size = layout.boardSize();
-        if (size >= colors.size()) {
+        if (size > colors.size()) {
             cerr << "Board is too large: " << layout.boardSize() << " exceeds maximum board size " << colors.size() << "." << endl;
             return 1;
         }
@@ -102,42 +184,32 @@ int main(int argc, char* argv[])
         }
         std::default_random_engine generator;
         std::uniform_int_distribution<size_t> distribution(0, size - 1);
-        auto dice = std::bind(distribution, generator);
+        auto dice = std::bind(distribution, std::ref(generator));
         for (int i = 0; i < 10; ++i) {
             if (dice() > size / 2) {
-                swapRows(board, dice(), dice());
+                board.swapRows(dice(), dice());
             } else {
-                swapCols(board, dice(), dice());
+                board.swapCols(dice(), dice());
             }
         }
 
-        Solution solution;
-        for (auto const &position : layout.positions()) {
-            size_t row = position.row;
-            size_t col = position.col;
-            string fields;
-            fields.reserve(position.size);
-            Counter counter;
-            for (size_t i = 0, n = position.size; i < n; ++i) {
-                auto const value = board.at(row, col);
-                fields.push_back(value);
-                counter.add(value);
-                row += position.horizontal ? 0 : 1;
-                col += position.horizontal ? 1 : 0;
-            }
-            if (position.reverse) {
-                reverse(fields.begin(), fields.end());
-            }
-            Stone const stone(fields);
-            solution.push_back(make_pair(position, stone));
-        }
-
         size_t solutions = 0;
-        if (isNice(solution, layouts, solutions)) {
+        if (isNice(slice(board, layout), layouts, solutions)) {
+            if (solutions > 1 && solutions <= refine_limit && refine_steps > 0 && size > 1) {
+                solutions = refine(board, layout, layouts, solutions, refine_steps, generator);
+            }
+            auto const solution = slice(board, layout);
+            ++puzzles;
             cout << "Found " << solutions << " solutions, among them this one:" << endl;
             Solver::printSolution(solution);
             cout << "The board looks like this:" << endl;
             board.print();
         }
     }
+    if (progress) {
+        progress->finish();
+    }
+    if (mem_stats) {
+        Memory::report(cerr);
+    }
 }
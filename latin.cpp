@@ -0,0 +1,242 @@
+// Copyright 2018 Dennis Nienhüser
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "latin.h"
+#include "memory.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <numeric>
+
+using namespace std;
+
+// Fills the cells of a reduced Latin square from the given one on, adding each square completed
+static void extend(vector<uint8_t> &square, size_t size, size_t cell, vector<vector<uint8_t>> &squares)
+{
+    if (cell == size * size) {
+        squares.push_back(square);
+        return;
+    }
+    size_t const row = cell / size;
+    size_t const col = cell % size;
+    if (row == 0 || col == 0) {
+        // The first row and column are in order
+        square[cell] = uint8_t(row + col);
+        extend(square, size, cell + 1, squares);
+        return;
+    }
+    for (uint8_t value = 0; value < size; ++value) {
+        bool used = false;
+        for (size_t i = 0; i < col && !used; ++i) {
+            used = square[row * size + i] == value;
+        }
+        for (size_t i = 0; i < row && !used; ++i) {
+            used = square[i * size + col] == value;
+        }
+        if (!used) {
+            square[cell] = value;
+            extend(square, size, cell + 1, squares);
+        }
+    }
+}
+
+LatinSolver::LatinSolver(const Stones &stones)
+{
+    size_t cells = 0;
+    ColorMask all = 0;
+    for (auto const &stone : stones) {
+        cells += stone.fields.size();
+        for (auto const value : stone.fields) {
+            all |= Palette::mask(value);
+        }
+    }
+    size_ = size_t(sqrt(cells));
+    if (size_ * size_ != cells) {
+        error_ = "The stones cover " + to_string(cells) + " cells, which is no square board.";
+    } else if (size_ > maxSize) {
+        error_ = "Boards larger than " + to_string(maxSize) + "x" + to_string(maxSize) + " have too many Latin squares.";
+    }
+    for (auto const &stone : stones) {
+        // The codes of the cut below have room for maxSize colors only
+        if (error_.empty() && stone.fields.size() > size_) {
+            error_ = "Stone " + stone.value() + " is longer than the board.";
+        }
+    }
+    if (!error_.empty()) {
+        // Nothing to search
+        size_ = 0;
+        return;
+    }
+    for (ColorId id = 0; id < Palette::maxColors; ++id) {
+        if (all & (ColorMask(1) << id)) {
+            colors_.push_back(id);
+        }
+    }
+
+    for (auto const &stone : stones) {
+        // Six bits per color
+        uint32_t forward = 0;
+        uint32_t backward = 0;
+        auto const n = stone.fields.size();
+        for (size_t i = 0; i < n; ++i) {
+            forward |= uint32_t(Palette::id(stone.fields[i])) << (6 * i);
+            backward |= uint32_t(Palette::id(stone.fields[i])) << (6 * (n - 1 - i));
+        }
+        auto const code = min(forward, backward);
+        auto piece = find_if(pieces_.begin(), pieces_.end(), [code, n](const Piece &piece) {
+            return piece.code == code && piece.size == n;
+        });
+        if (piece == pieces_.end()) {
+            Piece added;
+            added.code = code;
+            added.size = n;
+            added.stone = stone;
+            added.forward = forward;
+            pieces_.push_back(added);
+            piece = prev(pieces_.end());
+        }
+        ++piece->count;
+        if (find(sizes_.begin(), sizes_.end(), n) == sizes_.end()) {
+            sizes_.push_back(n);
+        }
+    }
+    sort(sizes_.begin(), sizes_.end());
+}
+
+string const &LatinSolver::error() const
+{
+    return error_;
+}
+
+size_t LatinSolver::findBoards(const Callback &callback) const
+{
+    if (size_ == 0 || colors_.size() != size_) {
+        // A Latin square has as many colors as rows
+        return 0;
+    }
+    TraceSpan span("LatinSolver::findBoards");
+    MemoryPhase phase(Memory::Solve);
+    size_t const n = size_;
+    size_t boards = 0;
+    vector<size_t> rows(n - 1);
+    iota(rows.begin(), rows.end(), 1);
+    vector<size_t> renaming(n);
+    iota(renaming.begin(), renaming.end(), 0);
+    vector<ColorId> board(n * n);
+    auto pieces = pieces_;
+    Solution solution;
+    for (auto const &square : reducedSquares(n)) {
+        do {
+            do {
+                for (size_t row = 0; row < n; ++row) {
+                    auto const source = row == 0 ? 0 : rows[row - 1];
+                    for (size_t col = 0; col < n; ++col) {
+                        board[row * n + col] = colors_[renaming[square[source * n + col]]];
+                    }
+                }
+                solution.clear();
+                if (cut(board, 0, pieces, solution)) {
+                    ++boards;
+                    callback(solution);
+                }
+            } while (next_permutation(renaming.begin(), renaming.end()));
+        } while (next_permutation(rows.begin(), rows.end()));
+    }
+    return boards;
+}
+
+vector<vector<uint8_t>> const &LatinSolver::reducedSquares(size_t size)
+{
+    static mutex lock;
+    static map<size_t, vector<vector<uint8_t>>> squares;
+    lock_guard<mutex> guard(lock);
+    auto cached = squares.find(size);
+    if (cached == squares.end()) {
+        vector<uint8_t> square(size * size);
+        cached = squares.insert({size, vector<vector<uint8_t>>()}).first;
+        if (size > 0) {
+            extend(square, size, 0, cached->second);
+        }
+    }
+    return cached->second;
+}
+
+bool LatinSolver::cut(const vector<ColorId> &board, uint64_t covered, vector<Piece> &pieces, Solution &solution) const
+{
+    size_t const n = size_;
+    size_t cell = 0;
+    while (cell < n * n && (covered >> cell & 1)) {
+        ++cell;
+    }
+    if (cell == n * n) {
+        return true;
+    }
+    // All cells before are covered, so a stone covering this one starts here
+    size_t const row = cell / n;
+    size_t const col = cell % n;
+    for (auto const size : sizes_) {
+        for (size_t horizontal = 0; horizontal < (size == 1 ? 1 : 2); ++horizontal) {
+            if ((horizontal ? col : row) + size > n) {
+                continue;
+            }
+            uint64_t cells = 0;
+            uint32_t forward = 0;
+            uint32_t backward = 0;
+            for (size_t i = 0; i < size; ++i) {
+                auto const index = horizontal ? cell + i : cell + i * n;
+                cells |= uint64_t(1) << index;
+                forward |= uint32_t(board[index]) << (6 * i);
+                backward |= uint32_t(board[index]) << (6 * (size - 1 - i));
+            }
+            if (covered & cells) {
+                continue;
+            }
+            auto const code = min(forward, backward);
+            for (auto &piece : pieces) {
+                if (piece.code != code || piece.size != size) {
+                    continue;
+                }
+                if (piece.count > 0) {
+                    --piece.count;
+                    solution.push_back({{size, row, col, horizontal == 1, piece.forward != forward}, piece.stone});
+                    bool const done = cut(board, covered | cells, pieces, solution);
+                    ++piece.count;
+                    if (done) {
+                        return true;
+                    }
+                    solution.pop_back();
+                }
+                break;
+            }
+        }
+    }
+    return false;
+}
@@ -0,0 +1,85 @@
+// Copyright 2018 Dennis Nienhüser
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef LATIN_H
+#define LATIN_H
+
+#include "puzzle.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// Solves small boards the other way round: Every solution is a Latin square, so it enumerates the Latin
+// squares in the colors of the stones and checks for each whether the stones can be cut out of it. Each
+// Latin square is a reduced one (first row and column in order) with its rows other than the first
+// permuted and its colors renamed, in exactly one way. The reduced squares are few (56 of size 5) and
+// computed once.
+// It shares nothing with the layout search of Solver, which makes it an independent check of the counts
+// of Solver. It is no faster alternative: Cutting all 161280 Latin squares of size 5 takes far longer
+// than Solver needs for a 5x5 puzzle.
+class LatinSolver
+{
+public:
+    // Receives each board found and one way to cut the stones out of it
+    using Callback = std::function<void(const Solution &)>;
+
+    // Larger boards have too many Latin squares: 812851200 of size 6 compared to 161280 of size 5
+    static constexpr size_t maxSize = 5;
+
+    explicit LatinSolver(const Stones & stones);
+    // Why the stones cannot be searched, e.g. a board larger than maxSize. Empty if they can.
+    std::string const & error() const;
+    // Calls back for each board, rotated and mirrored ones included. Returns the number of boards, which
+    // is zero if there is an error.
+    size_t findBoards(const Callback & callback) const;
+    // Reduced Latin squares of the given size, row by row, each cell holding a number below the size
+    static std::vector<std::vector<uint8_t>> const & reducedSquares(size_t size);
+
+private:
+    // Stones with the same colors in either direction, identified by their colors in the smaller direction
+    struct Piece {
+        uint32_t code = 0;
+        size_t size = 0;
+        size_t count = 0;
+        Stone stone = Stone(std::string());
+        // Colors of the stone as given
+        uint32_t forward = 0;
+    };
+
+    bool cut(const std::vector<ColorId> & board, uint64_t covered, std::vector<Piece> & pieces,
+             Solution & solution) const;
+
+    size_t size_ = 0;
+    std::string error_;
+    std::vector<ColorId> colors_;
+    std::vector<Piece> pieces_;
+    std::vector<size_t> sizes_;
+};
+
+#endif
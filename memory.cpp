@@ -0,0 +1,200 @@
+// Copyright 2018 Dennis Nienhüser
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "memory.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+using namespace std;
+
+static thread_local Memory::Phase currentPhase = Memory::Other;
+static thread_local uint64_t threadAllocations = 0;
+
+#ifdef FIVE_COLORS_ALLOCATION_TRACKING
+
+static atomic<uint64_t> phaseAllocations[Memory::Phases];
+static atomic<uint64_t> phaseBytes[Memory::Phases];
+static atomic<uint64_t> phaseLive[Memory::Phases];
+static atomic<uint64_t> phasePeak[Memory::Phases];
+
+// Precedes each block, such that freeing it knows the size and phase to account it to. The size keeps
+// the block behind it aligned for any type.
+struct alignas(alignof(max_align_t)) Header {
+    size_t size;
+    Memory::Phase phase;
+};
+
+static void *allocate(size_t size)
+{
+    auto *header = static_cast<Header*>(malloc(sizeof(Header) + size));
+    if (!header) {
+        return nullptr;
+    }
+    auto const phase = currentPhase;
+    header->size = size;
+    header->phase = phase;
+    ++threadAllocations;
+    phaseAllocations[phase].fetch_add(1, memory_order_relaxed);
+    phaseBytes[phase].fetch_add(size, memory_order_relaxed);
+    auto const live = phaseLive[phase].fetch_add(size, memory_order_relaxed) + size;
+    auto peak = phasePeak[phase].load(memory_order_relaxed);
+    while (live > peak && !phasePeak[phase].compare_exchange_weak(peak, live, memory_order_relaxed)) {
+        // peak was updated, try again
+    }
+    return header + 1;
+}
+
+static void release(void *pointer)
+{
+    if (!pointer) {
+        return;
+    }
+    auto *header = static_cast<Header*>(pointer) - 1;
+    phaseLive[header->phase].fetch_sub(header->size, memory_order_relaxed);
+    free(header);
+}
+
+void *operator new(size_t size)
+{
+    void *result = allocate(size);
+    if (!result) {
+        throw bad_alloc();
+    }
+    return result;
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void *operator new(size_t size, const nothrow_t &) noexcept
+{
+    return allocate(size);
+}
+
+void *operator new[](size_t size, const nothrow_t &) noexcept
+{
+    return allocate(size);
+}
+
+void operator delete(void *pointer) noexcept
+{
+    release(pointer);
+}
+
+void operator delete[](void *pointer) noexcept
+{
+    release(pointer);
+}
+
+void operator delete(void *pointer, size_t) noexcept
+{
+    release(pointer);
+}
+
+void operator delete[](void *pointer, size_t) noexcept
+{
+    release(pointer);
+}
+
+void operator delete(void *pointer, const nothrow_t &) noexcept
+{
+    release(pointer);
+}
+
+void operator delete[](void *pointer, const nothrow_t &) noexcept
+{
+    release(pointer);
+}
+
+bool Memory::tracked()
+{
+    return true;
+}
+
+Memory::Stats Memory::stats(Phase phase)
+{
+    Stats result;
+    result.allocations = phaseAllocations[phase].load(memory_order_relaxed);
+    result.bytes = phaseBytes[phase].load(memory_order_relaxed);
+    result.peak = phasePeak[phase].load(memory_order_relaxed);
+    return result;
+}
+
+#else
+
+bool Memory::tracked()
+{
+    return false;
+}
+
+Memory::Stats Memory::stats(Phase)
+{
+    return Stats();
+}
+
+#endif
+
+char const *Memory::name(Phase phase)
+{
+    static char const * const names[Phases] = {"other", "layouts", "solve", "output"};
+    return phase < Phases ? names[phase] : "";
+}
+
+uint64_t Memory::allocations()
+{
+    return threadAllocations;
+}
+
+void Memory::report(ostream &stream)
+{
+    if (!tracked()) {
+        stream << "Memory statistics are not available, build with FIVE_COLORS_ALLOCATION_TRACKING to collect them." << endl;
+        return;
+    }
+    for (int i = 0; i < Phases; ++i) {
+        auto const phase = Phase(i);
+        auto const result = stats(phase);
+        stream << name(phase) << ": " << result.allocations << " allocations, " << result.bytes << " bytes, ";
+        stream << result.peak << " bytes peak" << endl;
+    }
+}
+
+Memory::Phase Memory::phase()
+{
+    return currentPhase;
+}
+
+void Memory::setPhase(Phase phase)
+{
+    currentPhase = phase;
+}
@@ -0,0 +1,90 @@
+// Copyright 2018 Dennis Nienhüser
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MEMORY_H
+#define MEMORY_H
+
+#include <cstdint>
+#include <ostream>
+
+// Allocation statistics per program phase. They are only collected in builds with the CMake option
+// FIVE_COLORS_ALLOCATION_TRACKING, which replaces the global operator new and delete.
+class Memory
+{
+public:
+    enum Phase {
+        Other,
+        Layouts,
+        Solve,
+        Output,
+        Phases
+    };
+
+    struct Stats {
+        uint64_t allocations = 0;
+        uint64_t bytes = 0;
+        // Most bytes allocated in the phase and not freed yet at any time
+        uint64_t peak = 0;
+    };
+
+    // Whether this build collects statistics
+    static bool tracked();
+    static Stats stats(Phase phase);
+    static char const * name(Phase phase);
+    // Allocations made by the calling thread so far, in any phase
+    static uint64_t allocations();
+    // One line per phase
+    static void report(std::ostream &stream);
+
+    // Phase of the calling thread
+    static Phase phase();
+    static void setPhase(Phase phase);
+};
+
+// Attributes the allocations during its lifetime to a phase, then restores the previous one
+class MemoryPhase
+{
+public:
+    explicit MemoryPhase(Memory::Phase phase) : previous_(Memory::phase())
+    {
+        Memory::setPhase(phase);
+    }
+
+    ~MemoryPhase()
+    {
+        Memory::setPhase(previous_);
+    }
+
+    MemoryPhase(const MemoryPhase &) = delete;
+    MemoryPhase &operator=(const MemoryPhase &) = delete;
+
+private:
+    Memory::Phase previous_;
+};
+
+#endif
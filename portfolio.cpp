@@ -0,0 +1,116 @@
+// Copyright 2018 Dennis Nienhüser
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "portfolio.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+using namespace std;
+
+Portfolio::Portfolio(const Layouts &layouts, const Stones &stones)
+    : layouts_(layouts.begin(), layouts.end()), stones_(stones)
+{
+    // nothing to do
+}
+
+void Portfolio::setOrderings(size_t orderings)
+{
+    orderings_ = max(size_t(1), orderings);
+}
+
+void Portfolio::setSeed(uint64_t seed)
+{
+    seed_ = seed;
+}
+
+FirstSolution Portfolio::find(size_t threads, const SolveOptions &options) const
+{
+    auto const orderings = min(orderings_, max(size_t(1), threads));
+    auto const groups = max(size_t(1), min(layouts_.size(), max(size_t(1), threads) / orderings));
+
+    // Layouts are spread round-robin, such that each group gets small and large ones
+    vector<Layouts> layouts(groups);
+    vector<vector<size_t>> indices(groups);
+    for (size_t i = 0; i < layouts_.size(); ++i) {
+        layouts[i % groups].push_back(layouts_[i]);
+        indices[i % groups].push_back(i);
+    }
+
+    atomic<bool> cancel(options.cancel && options.cancel->load(memory_order_relaxed));
+    SolveOptions shared = options;
+    shared.cancel = &cancel;
+    mutex lock;
+    condition_variable done;
+    size_t running = groups * orderings;
+    FirstSolution result;
+    result.complete = true;
+
+    vector<thread> workers;
+    for (size_t group = 0; group < groups; ++group) {
+        for (size_t ordering = 0; ordering < orderings; ++ordering) {
+            workers.emplace_back([&, group, ordering] {
+                FirstSolver solver(layouts[group], stones_, seed_ + group * orderings + ordering);
+                auto const found = solver.find(shared);
+                lock_guard<mutex> guard(lock);
+                result.nodes += found.nodes;
+                result.restarts += found.restarts;
+                if (found.found && !result.found) {
+                    result.found = true;
+                    result.layout = indices[group][found.layout];
+                    result.solution = found.solution;
+                    cancel.store(true, memory_order_relaxed);
+                } else if (!found.complete && !result.found) {
+                    // Stopped by a limit rather than by another worker's solution
+                    result.complete = false;
+                }
+                --running;
+                done.notify_one();
+            });
+        }
+    }
+
+    {
+        // Forward a cancellation from the caller
+        unique_lock<mutex> guard(lock);
+        while (running > 0) {
+            done.wait_for(guard, chrono::milliseconds(10));
+            if (options.cancel && options.cancel->load(memory_order_relaxed)) {
+                cancel.store(true, memory_order_relaxed);
+            }
+        }
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    if (result.found) {
+        result.complete = true;
+    }
+    return result;
+}
@@ -0,0 +1,55 @@
+// Copyright 2018 Dennis Nienhüser
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef PORTFOLIO_H
+#define PORTFOLIO_H
+
+#include "puzzle.h"
+
+// Answers whether any layout has a solution using several threads. The layouts are split into groups,
+// and each group is searched by one or more workers, each with its own random order. The first worker to
+// find a solution publishes it and stops all others through a shared flag.
+class Portfolio
+{
+public:
+    Portfolio(const Layouts & layouts, const Stones & stones);
+    // Workers per group of layouts, each with a different seed
+    void setOrderings(size_t orderings);
+    void setSeed(uint64_t seed);
+    // Uses the given number of threads. Stops at the limits of the options; the node limit applies to each
+    // worker.
+    FirstSolution find(size_t threads, const SolveOptions & options = SolveOptions()) const;
+
+private:
+    std::vector<Layout> layouts_;
+    Stones stones_;
+    size_t orderings_ = 1;
+    uint64_t seed_ = 0;
+};
+
+#endif
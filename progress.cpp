@@ -0,0 +1,108 @@
+// Copyright 2018 Dennis Nienhüser
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "progress.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+
+Progress::Progress(uint64_t layouts, chrono::seconds interval, const string &statusFile)
+    : layouts_(layouts), interval_(interval), statusFile_(statusFile), start_(Time::now()),
+      next_(start_ + interval)
+{
+    // nothing to do
+}
+
+void Progress::startLayout(double placements)
+{
+    ++started_;
+    estimated_ += placements;
+}
+
+void Progress::report()
+{
+    next_ = Time::now() + interval_;
+    if (statusFile_.empty()) {
+        cerr << status() << endl;
+        return;
+    }
+    string const temporary = statusFile_ + ".tmp";
+    {
+        ofstream file(temporary);
+        file << status() << '\n';
+        if (!file) {
+            return;
+        }
+    }
+    rename(temporary.c_str(), statusFile_.c_str());
+}
+
+void Progress::finish()
+{
+    finished_ = true;
+    report();
+}
+
+string Progress::status() const
+{
+    // Layouts finished before the current one
+    auto const done = finished_ || started_ == 0 ? started_ : started_ - 1;
+    double const elapsed = chrono::duration<double>(Time::now() - start_).count();
+    ostringstream stream;
+    stream.precision(3);
+    stream << "Progress: " << done << "/" << layouts_ << " layouts";
+    if (layouts_ > 0) {
+        stream << " (" << 100.0 * double(done) / double(layouts_) << "%)";
+    }
+    stream << ", " << solutions_ << " solution(s)";
+    if (placements_ > 0) {
+        stream << ", " << double(placements_) << " placements";
+    }
+
+    if (finished_) {
+        stream << ", done after " << uint64_t(elapsed + 0.5) << " s";
+        return stream.str();
+    }
+    double left = -1;
+    if (estimated_ > 0 && started_ > 0 && placements_ > 0) {
+        auto const total = estimated_ * double(layouts_) / double(started_);
+        auto const remaining = max(0.0, total - double(placements_));
+        stream << ", about " << remaining << " placements left";
+        left = remaining * elapsed / double(placements_);
+    } else if (done > 0) {
+        left = elapsed * double(layouts_ - min(done, layouts_)) / double(done);
+    }
+    if (left >= 0) {
+        stream << ", about " << uint64_t(left + 0.5) << " s left";
+    }
+    return stream.str();
+}
@@ -0,0 +1,76 @@
+// Copyright 2018 Dennis Nienhüser
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef PROGRESS_H
+#define PROGRESS_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Periodically reports how far a search over many layouts got and how long the rest takes. The estimate is
+// based on the estimated search tree sizes of the layouts started so far, extrapolated to all layouts.
+// Without tree size estimates, the layouts are assumed to take equally long.
+class Progress
+{
+public:
+    using Time = std::chrono::steady_clock;
+
+    // Reports to stderr, or to the status file if given, which is replaced each time
+    Progress(uint64_t layouts, std::chrono::seconds interval, const std::string &statusFile = std::string());
+
+    // A layout is started with the estimated number of placements its search takes
+    void startLayout(double placements = 0);
+    // Reports if the interval passed since the last report
+    void update(uint64_t placements, uint64_t solutions)
+    {
+        placements_ = placements;
+        solutions_ = solutions;
+        if (Time::now() >= next_) {
+            report();
+        }
+    }
+    void report();
+    // Reports once more after the last layout is done
+    void finish();
+    std::string status() const;
+
+private:
+    uint64_t layouts_;
+    std::chrono::seconds interval_;
+    std::string statusFile_;
+    Time::time_point start_;
+    Time::time_point next_;
+    uint64_t started_ = 0;
+    double estimated_ = 0;
+    uint64_t placements_ = 0;
+    uint64_t solutions_ = 0;
+    bool finished_ = false;
+};
+
+#endif
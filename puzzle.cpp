@@ -27,36 +27,50 @@
 // POSSIBILITY OF SUCH DAMAGE.
 
 #include "puzzle.h"
+#include "memory.h"
+#include "trace.h"
 
 #include <cmath>
+#include <functional>
 #include <iostream>
 #include <iterator>
+#include <limits>
 #include <algorithm>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <tuple>
+#include <unordered_map>
 
 using namespace std;
 
 Stone::Stone(const std::string &value)
 {
-    fields.resize(value.size());
-    for (size_t i = 0; i < value.size(); ++i) {
-        fields[i] = value[i];
+    if (value.size() > maxSize) {
+        // Cutting it off would make it a different stone
+        throw length_error("Stone " + value + " is longer than the maximum of " + to_string(maxSize) + " colors.");
+    }
+    auto const n = value.size();
+    fields.size_ = uint8_t(n);
+    reversed.size_ = uint8_t(n);
+    for (size_t i = 0; i < n; ++i) {
+        fields.data_[i] = value[i];
+        reversed.data_[n - 1 - i] = value[i];
+        colors |= Palette::mask(value[i]);
     }
 }
 
-inline bool Stone::operator==(const Stone &other) const
+bool Stone::operator==(const Stone &other) const
 {
     return fields == other.fields;
 }
 
 string Stone::value() const
 {
-    string result;
-    result.resize(fields.size());
-    copy(fields.begin(), fields.end(), back_inserter(result));
-    return result;
+    return string(fields.begin(), fields.end());
 }
 
-inline bool Position::operator==(const Position &other) const
+bool Position::operator==(const Position &other) const
 {
     return size == other.size && row == other.row && col == other.col &&
            horizontal == other.horizontal && reverse == other.reverse;
@@ -79,13 +93,73 @@ inline bool Position::operator<(const Position &b) const
     return reverse < b.reverse;
 }
 
-Board::Board(size_t size) : data_(size, Row(size, empty_)), size_(size)
+static string const paletteSymbols = "BDGYRVOMPSTWCFIKLAEHJNQUXZabcdefghijklmnopqrstuvwxyz0123456789@#";
+
+static array<ColorId, 256> paletteIds()
+{
+    assert(paletteSymbols.size() == Palette::maxColors);
+    array<ColorId, 256> result;
+    result.fill(Palette::invalid);
+    for (size_t i = 0; i < paletteSymbols.size(); ++i) {
+        result[uint8_t(paletteSymbols[i])] = ColorId(i);
+    }
+    return result;
+}
+
+static array<ColorMask, 256> paletteMasks()
+{
+    array<ColorMask, 256> result;
+    result.fill(0);
+    for (size_t i = 0; i < paletteSymbols.size(); ++i) {
+        result[uint8_t(paletteSymbols[i])] = ColorMask(1) << i;
+    }
+    return result;
+}
+
+array<ColorId, 256> const Palette::ids_ = paletteIds();
+array<ColorMask, 256> const Palette::masks_ = paletteMasks();
+
+string const &Palette::symbols()
+{
+    return paletteSymbols;
+}
+
+string const &Palette::name(char symbol)
+{
+    static auto const names = []() {
+        vector<string> result(paletteSymbols.size());
+        for (size_t i = 0; i < paletteSymbols.size(); ++i) {
+            result[i] = string(1, paletteSymbols[i]);
+        }
+        map<char, string> const common = {
+            {'B', "blue"}, {'C', "cyan"}, {'D', "black"}, {'F', "fuchsia"}, {'G', "green"}, {'I', "indigo"},
+            {'K', "khaki"}, {'L', "lime"}, {'M', "magenta"}, {'O', "orange"}, {'P', "pink"}, {'R', "red"},
+            {'S', "silver"}, {'T', "teal"}, {'V', "violet"}, {'W', "white"}, {'Y', "yellow"}
+        };
+        for (auto const &name : common) {
+            result[id(name.first)] = name.second;
+        }
+        return result;
+    }();
+    static string const unknown = "?";
+    auto const color = id(symbol);
+    return color == invalid ? unknown : names[color];
+}
+
+bool Palette::contains(const string &value)
+{
+    return all_of(value.begin(), value.end(), [](char symbol) { return id(symbol) != invalid; });
+}
+
+Board::Board(size_t size) : data_(size, Row(size, empty_)), size_(size),
+    rows_(size, 0), cols_(size, 0), counts_(2 * size * Palette::maxColors, 0)
 {
     // does nothing
 }
 
 Board::Board(size_t size, const Solution &solution) :
-    data_(size, Row(size, empty_)), size_(size)
+    data_(size, Row(size, empty_)), size_(size),
+    rows_(size, 0), cols_(size, 0), counts_(2 * size * Palette::maxColors, 0)
 {
     for (auto const &value: solution) {
         assign(value.first, value.second);
@@ -104,51 +178,94 @@ inline bool Board::isEmpty(size_t row, size_t col) const
     return data_[row][col] == empty_;
 }
 
-inline bool Board::canAssign(const Position &position, const Stone &stone) const
+void Board::unassign(const Position &position, const Stone &stone)
 {
     size_t row = position.row;
     size_t col = position.col;
     for (size_t i = 0, n = stone.fields.size(); i < n; ++i) {
-        if (row >= size_ || col >= size_ || data_[row][col] != empty_) {
-            return false;
-        }
+        assign(row, col, empty_);
         row += position.horizontal ? 0 : 1;
         col += position.horizontal ? 1 : 0;
     }
-    return true;
 }
 
-inline void Board::unassign(const Position &position, const Stone &stone)
+void Board::swapRows(size_t rowA, size_t rowB)
+{
+    // Columns keep their colors
+    swap(data_[rowA], data_[rowB]);
+    swap(rows_[rowA], rows_[rowB]);
+    swap_ranges(counts_.begin() + long(rowA * Palette::maxColors),
+                counts_.begin() + long((rowA + 1) * Palette::maxColors),
+                counts_.begin() + long(rowB * Palette::maxColors));
+}
+
+void Board::swapCols(size_t colA, size_t colB)
+{
+    // Rows keep their colors
+    for (auto &row : data_) {
+        swap(row[colA], row[colB]);
+    }
+    swap(cols_[colA], cols_[colB]);
+    swap_ranges(counts_.begin() + long((size_ + colA) * Palette::maxColors),
+                counts_.begin() + long((size_ + colA + 1) * Palette::maxColors),
+                counts_.begin() + long((size_ + colB) * Palette::maxColors));
+}
+
+size_t Board::switchCycle(size_t rowA, size_t rowB, size_t col)
 {
-    Stone empty = stone;
-    empty.fields.assign(empty.fields.size(), empty_);
-    assign(position, empty);
+    assert(rowA != rowB);
+    size_t count = 0;
+    size_t current = col;
+    while (current < size_) {
+        auto const up = data_[rowB][current];
+        auto const down = data_[rowA][current];
+        remove(rowA, current, down);
+        remove(rowB, current, up);
+        add(rowA, current, up);
+        add(rowB, current, down);
+        data_[rowA][current] = up;
+        data_[rowB][current] = down;
+        ++count;
+        // The color that moved up occurs in rowA once more unless the cycle is closed
+        auto next = size_;
+        for (size_t i = 0; i < size_; ++i) {
+            if (i != current && data_[rowA][i] == up) {
+                next = i;
+            }
+        }
+        current = next;
+    }
+    return count;
 }
 
 void Board::print() const
 {
-    printf("%s", string(4 * size_, '-').c_str());
-    printf("\n");
+    TraceSpan span("Board::print");
+    MemoryPhase phase(Memory::Output);
+    // Format everything first and hand it over to the stream at once
+    string const line(4 * size_, '-');
+    string output;
+    output.reserve((size_ + 3) * (4 * size_ + 2));
+    output += line;
+    output += '\n';
     for (size_t row = 0; row < size_; ++row) {
-        cout << '|';
+        output += '|';
         for (size_t col = 0; col < size_; ++col) {
-            printf(" %c |", data_[row][col]);
+            output += ' ';
+            output += data_[row][col];
+            output += " |";
         }
-        printf("\n");
+        output += '\n';
     }
-    printf("%s", string(4 * size_, '-').c_str());
-    printf("\n");
+    output += line;
+    output += '\n';
 
     if (isValid()) {
-        cout << "Board is valid";
-        if (isFull()) {
-            cout << " and full." << endl;
-        } else {
-            cout << "." << endl;
-        }
+        output += isFull() ? "Board is valid and full.\n" : "Board is valid.\n";
     } else {
-        cout << "BOARD IS NOT VALID." << endl;
+        output += "BOARD IS NOT VALID.\n";
     }
+    cout << output << flush;
 }
 
 string Board::signature() const
@@ -197,19 +314,13 @@ std::vector<Position> const & Layout::positions() const
 
 string Layout::signature() const
 {
-    Board board(size_);
+    string result(size_ * size_, ' ');
     char counter = 'A';
     for (auto const &position : positions_) {
-        string value;
-        value.reserve(position.size);
-        for (size_t i = 0; i < position.size; ++i) {
-            value.push_back(counter);
-        }
-        Stone stone(value);
-        board.assign(position, stone);
+        paint(result, position, counter);
         ++counter;
     }
-    return board.signature();
+    return result;
 }
 
 void Layout::rotate90()
@@ -251,6 +362,17 @@ void Layout::rotate90(size_t &row, size_t &col) const
     row = original_col;
 }
 
+void Layout::paint(string &grid, const Position &position, char value) const
+{
+    size_t row = position.row;
+    size_t col = position.col;
+    for (size_t i = 0; i < position.size; ++i) {
+        grid[row * size_ + col] = value;
+        row += position.horizontal ? 0 : 1;
+        col += position.horizontal ? 1 : 0;
+    }
+}
+
 void Layout::normalize()
 {
     sort(positions_.begin(), positions_.end());
@@ -317,13 +439,11 @@ ostream &operator<<(ostream &stream, const Layout &layout)
         stream << "\n";
     }
 
-    Board board(layout.size_);
+    string grid(layout.size_ * layout.size_, ' ');
     for (auto const &position : layout.positions_) {
-        char const value = (position.horizontal ? 'A' : 'a') + char(position.size);
-        Stone stone(string(position.size, value));
-        board.assign(position, stone);
+        layout.paint(grid, position, (position.horizontal ? 'A' : 'a') + char(position.size));
     }
-    stream << board;
+    stream << grid;
     return stream;
 }
 
@@ -340,126 +460,1180 @@ Solver::Solver(const Layout &layout, const Stones &stones)
 
 Solutions Solver::findAssignment() const
 {
-    Board board(layout_.boardSize());
-    Stones stones = stones_;
-    size_t layoutIndex = 0;
-    Solution solution;
+    TraceSpan span("Solver::findAssignment");
+    MemoryPhase phase(Memory::Solve);
     Solutions solutions;
-    findAssignment(solutions, board, stones, layoutIndex, solution);
+    for (auto iterator = begin(); !iterator.atEnd(); iterator.next()) {
+        solutions.push_back(iterator.solution());
+    }
     return solutions;
 }
 
+SolveResult Solver::findAssignment(const SolveOptions &options) const
+{
+    TraceSpan span("Solver::findAssignment");
+    MemoryPhase phase(Memory::Solve);
+    SolveResult result;
+    SolutionIterator iterator(layout_, stones_, options);
+    for (; !iterator.atEnd(); iterator.next()) {
+        result.solutions.push_back(iterator.solution());
+    }
+    result.complete = !iterator.stopped();
+    result.best = iterator.best();
+    result.nodes = iterator.nodes();
+    return result;
+}
+
+SolutionStore Solver::findAll() const
+{
+    TraceSpan span("Solver::findAll");
+    MemoryPhase phase(Memory::Solve);
+    SolutionStore store(layout_, stones_);
+    for (auto iterator = begin(); !iterator.atEnd(); iterator.next()) {
+        store.add(iterator.choices());
+    }
+    return store;
+}
+
+SolutionIterator Solver::begin() const
+{
+    return SolutionIterator(layout_, stones_);
+}
+
+bool Solver::isFeasible(const Stones &stones, string &reason)
+{
+    size_t all = 0;
+    for (auto const &stone : stones) {
+        all += stone.fields.size();
+    }
+    size_t const size = size_t(sqrt(all));
+    if (size * size != all || stones.empty()) {
+        reason = "Stones do not fit into a squared board.";
+        return false;
+    }
+
+    vector<size_t> occurrences(Palette::maxColors, 0);
+    for (auto const &stone : stones) {
+        if (stone.fields.size() > size) {
+            reason = "Stone " + stone.value() + " does not fit into the board.";
+            return false;
+        }
+        ColorMask colors = 0;
+        for (auto value : stone.fields) {
+            auto const color = Palette::mask(value);
+            if (!color) {
+                reason = "Stone " + stone.value() + " contains the unknown color " + string(1, value) + ".";
+                return false;
+            }
+            if (colors & color) {
+                reason = "Stone " + stone.value() + " contains " + Palette::name(value) + " twice, but it lies in a single row or column.";
+                return false;
+            }
+            colors |= color;
+            ++occurrences[Palette::id(value)];
+        }
+    }
+
+    // Every color occurs once in each row. This also means there are as many colors as rows.
+    for (size_t i = 0; i < occurrences.size(); ++i) {
+        if (occurrences[i] > 0 && occurrences[i] != size) {
+            reason = "Color " + Palette::name(Palette::symbols()[i]) + " occurs " + to_string(occurrences[i]) +
+                     " times, but must occur once in each of the " + to_string(size) + " rows.";
+            return false;
+        }
+    }
+    return true;
+}
+
 void Solver::printSolution(const Solution &solution)
 {
-    map<char, string> names;
-    names['B'] = "blue";
-    names['C'] = "cyan";
-    names['D'] = "black";
-    names['F'] = "fuchsia";
-    names['G'] = "green";
-    names['I'] = "indigo";
-    names['K'] = "khaki";
-    names['L'] = "lime";
-    names['M'] = "magenta";
-    names['O'] = "orange";
-    names['P'] = "pink";
-    names['R'] = "red";
-    names['S'] = "silver";
-    names['T'] = "teal";
-    names['V'] = "violet";
-    names['W'] = "white";
-    names['Y'] = "yellow";
-    cout << "Solution:" << endl;
+    TraceSpan span("Solver::printSolution");
+    MemoryPhase phase(Memory::Output);
+    string output = "Solution:\n";
     for (auto const &assignment : solution) {
         Position const &position = assignment.first;
         Stone const &stone = assignment.second;
-        cout << "(" << position.row + 1 << "," << position.col + 1;
-        auto value = stone.fields;
-        if (position.reverse) {
-            reverse(value.begin(), value.end());
+        output += "(" + to_string(position.row + 1) + "," + to_string(position.col + 1);
+        output += position.horizontal ? ", horizontal) " : ", vertical)   ";
+        for (auto const value : position.reverse ? stone.reversed : stone.fields) {
+            output += Palette::name(value);
+            output += ' ';
+        }
+        output += '\n';
+    }
+    output += "Rotate and mirror this solution to produce variants of it.\n";
+    cout << output;
+}
+
+SolutionIterator::SolutionIterator(const Layout &layout, const Stones &stones, const SolveOptions &options)
+    : layout_(layout), stones_(stones.begin(), stones.end()), used_(stones.size(), false),
+      board_(layout.boardSize()), options_(options)
+{
+    prepare();
+    next();
+}
+
+SolutionIterator::SolutionIterator(const Layout &layout, const Stones &stones, const State &state,
+                                   const SolveOptions &options)
+    : layout_(layout), stones_(stones.begin(), stones.end()), used_(stones.size(), false),
+      cursor_(state.cursor), board_(layout.boardSize()), options_(options)
+{
+    prepare();
+    for (auto const &choice : state.path) {
+        assert(choice.stone < stones_.size() && !used_[choice.stone]);
+        board_.assign(position(path_.size(), choice), stones_[choice.stone]);
+        take(choice.stone);
+        path_.push_back(choice);
+    }
+    best_ = path_;
+}
+
+SolutionIterator::SolutionIterator(const Layout &layout, const Stones &stones, const Board &board,
+                                   const SolveOptions &options)
+    : layout_(layout), stones_(stones.begin(), stones.end()), used_(stones.size(), false),
+      board_(board), options_(options)
+{
+    assert(board.size() == layout.boardSize());
+    prepare();
+    next();
+}
+
+bool SolutionIterator::atEnd() const
+{
+    return atEnd_;
+}
+
+bool SolutionIterator::stopped() const
+{
+    return stopped_;
+}
+
+Solution const &SolutionIterator::solution() const
+{
+    assert(found_);
+    if (solution_.size() != path_.size()) {
+        solution_.clear();
+        for (size_t i = 0; i < path_.size(); ++i) {
+            solution_.push_back({position(i, path_[i]), stones_[path_[i].stone]});
+        }
+    }
+    return solution_;
+}
+
+vector<SolutionIterator::Choice> const &SolutionIterator::choices() const
+{
+    assert(found_);
+    return path_;
+}
+
+void SolutionIterator::next()
+{
+    next(numeric_limits<uint64_t>::max());
+}
+
+bool SolutionIterator::next(uint64_t nodes)
+{
+    if (atEnd_) {
+        return true;
+    }
+    if (found_) {
+        // Continue after the solution found last
+        found_ = false;
+        if (path_.empty()) {
+            // The only solution of an empty layout has been found already
+            atEnd_ = true;
+            return true;
+        }
+        cursor_ = remove();
+    }
+    return search(nodes_ + min(nodes, numeric_limits<uint64_t>::max() - nodes_));
+}
+
+uint64_t SolutionIterator::nodes() const
+{
+    return nodes_;
+}
+
+SolutionIterator::State SolutionIterator::state() const
+{
+    State result;
+    if (atEnd_ && !stopped_) {
+        // No stone is left to try at the first position
+        result.cursor = {stones_.size(), false};
+        return result;
+    }
+    result.path = path_;
+    result.cursor = cursor_;
+    if (found_) {
+        if (result.path.empty()) {
+            result.cursor = {stones_.size(), false};
+        } else {
+            result.cursor = following(result.path.back());
+            result.path.pop_back();
+        }
+    }
+    return result;
+}
+
+bool SolutionIterator::isValid(const Layout &layout, const Stones &stones, const State &state)
+{
+    auto const &positions = layout.positions();
+    // The last position is never part of a saved path, its stone is the cursor
+    if (state.cursor.stone > stones.size() || (!positions.empty() && state.path.size() >= positions.size()) ||
+        (positions.empty() && !state.path.empty())) {
+        return false;
+    }
+    vector<Stone> const values(stones.begin(), stones.end());
+    vector<bool> used(values.size(), false);
+    Board board(layout.boardSize());
+    for (size_t i = 0; i < state.path.size(); ++i) {
+        auto const &choice = state.path[i];
+        if (choice.stone >= values.size() || used[choice.stone]) {
+            return false;
+        }
+        auto const &stone = values[choice.stone];
+        Position position = positions[i];
+        position.reverse = position.reverse != choice.reverse;
+        if (stone.fields.size() != position.size || !board.canAssign(position, stone) || !board.fits(position, stone)) {
+            return false;
+        }
+        board.assign(position, stone);
+        used[choice.stone] = true;
+    }
+    return true;
+}
+
+Solution SolutionIterator::best() const
+{
+    Solution result;
+    for (size_t i = 0; i < best_.size(); ++i) {
+        result.push_back({position(i, best_[i]), stones_[best_[i].stone]});
+    }
+    return result;
+}
+
+double SolutionIterator::estimate(size_t probes, uint64_t seed)
+{
+    mt19937_64 random(seed);
+    auto const depth = path_.size();
+    auto const &positions = layout_.positions();
+    vector<Choice> choices;
+    double total = 0;
+    for (size_t probe = 0; probe < probes; ++probe) {
+        double branches = 1;
+        while (path_.size() < positions.size()) {
+            // Try every choice like place() does, remembering those that work
+            choices.clear();
+            double tried = 0;
+            for (size_t stone = 0; stone < stones_.size(); ++stone) {
+                if (used_[stone] || stones_[stone].fields.size() != positions[path_.size()].size) {
+                    continue;
+                }
+                for (auto const reverse : {false, true}) {
+                    Choice const choice = {stone, reverse};
+                    auto const position = this->position(path_.size(), choice);
+                    ++tried;
+                    if (board_.fits(position, stones_[stone])) {
+                        board_.assign(position, stones_[stone]);
+                        take(stone);
+                        path_.push_back(choice);
+                        if (canComplete()) {
+                            choices.push_back(choice);
+                        }
+                        remove();
+                    }
+                }
+            }
+            total += branches * tried;
+            if (choices.empty()) {
+                break;
+            }
+            branches *= double(choices.size());
+            auto const choice = choices[random() % choices.size()];
+            board_.assign(position(path_.size(), choice), stones_[choice.stone]);
+            take(choice.stone);
+            path_.push_back(choice);
         }
-        cout << (position.horizontal ? ", horizontal) " : ", vertical)   ");
-        for (auto v : value) {
-            cout << names[v] << ' ';
+        while (path_.size() > depth) {
+            remove();
         }
-        cout << '\n';
     }
-    cout << "Rotate and mirror this solution to produce variants of it.\n";
+    return probes > 0 ? total / double(probes) : 0;
 }
 
-void Solver::findAssignment(Solutions &solutions, Board &board, Stones &stones, size_t layoutIndex,
-                            Solution &solution) const
+bool SolutionIterator::search(uint64_t limit)
 {
-    auto const boardValid = board.isValid();
-    if (!boardValid) {
-        // No more solutions possible, stop recursion
-        return;
+    auto const depth = layout_.positions().size();
+    while (true) {
+        if (path_.size() == depth) {
+            // Solution found, suspend the search
+            solution_.clear();
+            found_ = true;
+            return true;
+        }
+
+        if (nodes_ >= check_) {
+            // Checking the limits is not for free, do it only every now and then
+            if (limitReached()) {
+                stopped_ = true;
+                atEnd_ = true;
+                return true;
+            }
+            check_ = nodes_ + min(uint64_t(1024), options_.maxNodes - nodes_);
+        }
+
+        if (nodes_ >= limit) {
+            // Out of budget, suspend the search
+            return false;
+        }
+
+        if (place(cursor_)) {
+            // Descend and try all choices for the next position
+            cursor_ = Choice();
+        } else if (path_.empty()) {
+            // Everything tried
+            atEnd_ = true;
+            return true;
+        } else {
+            // Backtrack and continue with the choice following the last one
+            cursor_ = remove();
+        }
     }
+}
 
-    if (boardValid && stones.empty()) {
-        // Solution found, stop recursion
-        solutions.push_back(solution);
-        return;
+bool SolutionIterator::limitReached() const
+{
+    return nodes_ >= options_.maxNodes ||
+           (options_.cancel && options_.cancel->load(memory_order_relaxed)) ||
+           (options_.deadline != SolveOptions::Time::time_point::max() &&
+            SolveOptions::Time::now() >= options_.deadline);
+}
+
+bool SolutionIterator::inShard(const Choice &choice) const
+{
+    // Mix the layout and the placements into a hash, which spreads the branches evenly across shards
+    auto const mix = [](uint64_t hash, uint64_t value) {
+        hash ^= value + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+        hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebULL;
+        return hash ^ (hash >> 31);
+    };
+    uint64_t hash = mix(0, options_.shard.layout);
+    for (auto const &placed : path_) {
+        hash = mix(hash, 2 * placed.stone + (placed.reverse ? 1 : 0));
     }
+    hash = mix(hash, 2 * choice.stone + (choice.reverse ? 1 : 0));
+    return hash % options_.shard.count == options_.shard.index;
+}
 
-    auto const & positions = layout_.positions();
-    for (size_t i = 0, n = stones.size(); i < n; ++i) {
-        Stone stone = stones.front();
-        stones.pop_front();
-        if (stone.fields.size() != positions[layoutIndex].size) {
-            // Stone in queue does not fit with position's stone type (size). Queue it.
-            stones.push_back(stone);
+bool SolutionIterator::place(Choice cursor)
+{
+    size_t const layoutIndex = path_.size();
+    size_t const size = layout_.positions()[layoutIndex].size;
+    // The branch is assigned to a shard once the placements identifying it are made
+    auto const depth = max(size_t(1), min(options_.shard.depth, layout_.positions().size()));
+    bool const sharded = options_.shard.count > 1 && layoutIndex + 1 == depth;
+    for (Choice choice = cursor; choice.stone < stones_.size(); choice = {choice.stone + 1, false}) {
+        auto const &stone = stones_[choice.stone];
+        if (used_[choice.stone] || stone.fields.size() != size) {
+            // Stone is placed already or does not fit with position's stone type (size)
             continue;
         }
-        {
-            // Try to fit the stone in forward direction. If it works, move on. Later on clean up.
-            board.assign(positions[layoutIndex], stone);
-            if (board.isValid()) {
-                solution.push_back({positions[layoutIndex], stone});
-                findAssignment(solutions, board, stones, layoutIndex + 1, solution);
-                solution.pop_back();
+        for (; ; choice.reverse = true) {
+            // Try to fit the stone in the current direction. If it works, move on.
+            auto const position = this->position(layoutIndex, choice);
+            ++nodes_;
+            if (board_.fits(position, stone) && (!sharded || inShard(choice))) {
+                board_.assign(position, stone);
+                take(choice.stone);
+                path_.push_back(choice);
+                if (canComplete()) {
+                    if (path_.size() > best_.size()) {
+                        best_ = path_;
+                    }
+                    return true;
+                }
+                // Some row or column misses a color that none of the stones left can supply
+                remove();
+            }
+            if (choice.reverse) {
+                break;
             }
-            board.unassign(positions[layoutIndex], stone);
         }
+    }
+    return false;
+}
 
-        {
-            // Try to fit the stone in backward direction. If it works, move on. Later on clean up.
-            Position reversed = positions[layoutIndex];
-            reversed.reverse = !reversed.reverse;
-            board.assign(reversed, stone);
-            if (board.isValid()) {
-                solution.push_back({reversed, stone});
-                findAssignment(solutions, board, stones, layoutIndex + 1, solution);
-                solution.pop_back();
+SolutionIterator::Choice SolutionIterator::remove()
+{
+    Choice const choice = path_.back();
+    path_.pop_back();
+    board_.unassign(position(path_.size(), choice), stones_[choice.stone]);
+    putBack(choice.stone);
+    return following(choice);
+}
+
+void SolutionIterator::prepare()
+{
+    auto const &positions = layout_.positions();
+    path_.reserve(positions.size());
+    best_.reserve(positions.size());
+
+    size_t const n = layout_.boardSize();
+    supply_.assign(n + 1, 0);
+    supplyCounts_.assign((n + 1) * Palette::maxColors, 0);
+    ColorMask all = 0;
+    for (size_t i = 0; i < stones_.size(); ++i) {
+        for (auto value : stones_[i].fields) {
+            all |= Palette::mask(value);
+        }
+        auto const size = stones_[i].fields.size();
+        if (find(sizes_.begin(), sizes_.end(), size) == sizes_.end()) {
+            sizes_.push_back(size);
+        }
+        if (size <= n) {
+            putBack(i);
+        }
+    }
+
+    for (size_t row = 0; row < n; ++row) {
+        // Stones placed before the search count as well
+        all |= board_.rowColors(row);
+    }
+    size_t colorCount = 0;
+    for (ColorMask colors = all; colors; colors &= colors - 1) {
+        ++colorCount;
+    }
+    // With a single stone size, the stones left always supply the colors missing
+    palette_ = colorCount == n && sizes_.size() > 1 ? all : 0;
+
+    // For each depth, the positions from there on cross the rows and columns that are not full yet
+    crossing_.assign((positions.size() + 1) * 2 * n, 0);
+    for (size_t depth = positions.size(); depth-- > 0; ) {
+        auto const &position = positions[depth];
+        auto *crossing = &crossing_[depth * 2 * n];
+        copy(crossing + 2 * n, crossing + 4 * n, crossing);
+        uint64_t const size = uint64_t(1) << (position.size - 1);
+        for (size_t i = 0; i < position.size; ++i) {
+            crossing[position.horizontal ? position.row : position.row + i] |= size;
+            crossing[n + (position.horizontal ? position.col + i : position.col)] |= size;
+        }
+    }
+}
+
+void SolutionIterator::take(size_t stone)
+{
+    used_[stone] = true;
+    auto const size = stones_[stone].fields.size();
+    for (auto value : stones_[stone].fields) {
+        auto const id = Palette::id(value);
+        if (id != Palette::invalid && --supplyCounts_[size * Palette::maxColors + id] == 0) {
+            supply_[size] &= ~(ColorMask(1) << id);
+        }
+    }
+}
+
+void SolutionIterator::putBack(size_t stone)
+{
+    used_[stone] = false;
+    auto const size = stones_[stone].fields.size();
+    for (auto value : stones_[stone].fields) {
+        auto const id = Palette::id(value);
+        if (id != Palette::invalid && supplyCounts_[size * Palette::maxColors + id]++ == 0) {
+            supply_[size] |= ColorMask(1) << id;
+        }
+    }
+}
+
+bool SolutionIterator::canComplete() const
+{
+    if (!palette_) {
+        return true;
+    }
+    // Only lines that the last stone crossed or that the stone's size could supply are affected by it
+    size_t const n = layout_.boardSize();
+    uint64_t const size = uint64_t(1) << (layout_.positions()[path_.size() - 1].size - 1);
+    auto const *before = &crossing_[(path_.size() - 1) * 2 * n];
+    auto const *crossing = &crossing_[path_.size() * 2 * n];
+    for (size_t line = 0; line < 2 * n; ++line) {
+        if (!(before[line] & size)) {
+            continue;
+        }
+        ColorMask const missing = palette_ & ~(line < n ? board_.rowColors(line) : board_.colColors(line - n));
+        ColorMask supply = 0;
+        for (auto size : sizes_) {
+            if (crossing[line] & (uint64_t(1) << (size - 1))) {
+                supply |= supply_[size];
             }
-            board.unassign(reversed, stone);
         }
-        stones.push_back(stone);
+        if (missing & ~supply) {
+            return false;
+        }
     }
+    return true;
 }
 
-Layouts LayoutGenerator::findAll(const Stones &stones)
+SolutionIterator::Choice SolutionIterator::following(const Choice &choice)
+{
+    return choice.reverse ? Choice({choice.stone + 1, false}) : Choice({choice.stone, true});
+}
+
+Position SolutionIterator::position(size_t layoutIndex, const Choice &choice) const
+{
+    Position result = layout_.positions()[layoutIndex];
+    if (choice.reverse) {
+        result.reverse = !result.reverse;
+    }
+    return result;
+}
+
+SolutionStore::SolutionStore(const Layout &layout, const Stones &stones)
+    : layout_(layout), stones_(stones.begin(), stones.end()), width_(stones.size() <= 128 ? 1 : 2)
+{
+    // nothing to do
+}
+
+void SolutionStore::add(const vector<SolutionIterator::Choice> &choices)
+{
+    assert(choices.size() == layout_.positions().size());
+    for (auto const &choice : choices) {
+        assert(choice.stone < stones_.size());
+        auto const code = (choice.stone << 1) | (choice.reverse ? 1 : 0);
+        for (size_t i = 0; i < width_; ++i) {
+            data_.push_back(uint8_t(code >> (8 * i)));
+        }
+    }
+    ++size_;
+}
+
+size_t SolutionStore::size() const
+{
+    return size_;
+}
+
+bool SolutionStore::empty() const
+{
+    return size_ == 0;
+}
+
+size_t SolutionStore::bytes() const
+{
+    return data_.size();
+}
+
+Layout const &SolutionStore::layout() const
+{
+    return layout_;
+}
+
+SolutionIterator::Choice SolutionStore::choice(size_t index, size_t placement) const
+{
+    auto const offset = (index * layout_.positions().size() + placement) * width_;
+    size_t code = 0;
+    for (size_t i = 0; i < width_; ++i) {
+        code |= size_t(data_[offset + i]) << (8 * i);
+    }
+    return {code >> 1, (code & 1) != 0};
+}
+
+Solution SolutionStore::solution(size_t index) const
+{
+    assert(index < size_);
+    Solution result;
+    auto const &positions = layout_.positions();
+    for (size_t i = 0; i < positions.size(); ++i) {
+        auto const placement = choice(index, i);
+        Position position = positions[i];
+        position.reverse = position.reverse != placement.reverse;
+        result.push_back({position, stones_[placement.stone]});
+    }
+    return result;
+}
+
+Board SolutionStore::board(size_t index) const
+{
+    assert(index < size_);
+    Board result(layout_.boardSize());
+    auto const &positions = layout_.positions();
+    for (size_t i = 0; i < positions.size(); ++i) {
+        auto const placement = choice(index, i);
+        Position position = positions[i];
+        position.reverse = position.reverse != placement.reverse;
+        result.assign(position, stones_[placement.stone]);
+    }
+    return result;
+}
+
+FirstSolver::FirstSolver(const Layouts &layouts, const Stones &stones, uint64_t seed)
+    : layouts_(layouts.begin(), layouts.end()), stones_(stones.begin(), stones.end()), seed_(seed)
+{
+    // nothing to do
+}
+
+void FirstSolver::setCutoff(uint64_t placements)
+{
+    cutoff_ = max(uint64_t(1), placements);
+}
+
+FirstSolution FirstSolver::find(const SolveOptions &options) const
+{
+    TraceSpan span("FirstSolver::find");
+    MemoryPhase phase(Memory::Solve);
+    FirstSolution result;
+    mt19937_64 random(seed_);
+    vector<size_t> open(layouts_.size());
+    iota(open.begin(), open.end(), 0);
+    vector<size_t> order(stones_.size());
+    iota(order.begin(), order.end(), 0);
+    vector<bool> flipped(stones_.size());
+    Stones stones;
+
+    for (uint64_t run = 1; !open.empty(); ++run) {
+        result.restarts = run - 1;
+        auto const cutoff = cutoff_ * luby(run);
+        shuffle(open.begin(), open.end(), random);
+        shuffle(order.begin(), order.end(), random);
+        stones.clear();
+        for (auto const index : order) {
+            // Trying a reversed stone first is the same as trying the stone in the other direction first
+            flipped[index] = random() & 1;
+            stones.push_back(stones_[index]);
+            if (flipped[index]) {
+                swap(stones.back().fields, stones.back().reversed);
+            }
+        }
+
+        for (size_t i = 0; i < open.size(); ) {
+            SolveOptions limited;
+            limited.deadline = options.deadline;
+            limited.cancel = options.cancel;
+            limited.maxNodes = min(cutoff, options.nodesLeft(result.nodes));
+            auto const &layout = layouts_[open[i]];
+            SolutionIterator iterator(layout, stones, limited);
+            result.nodes += iterator.nodes();
+            if (!iterator.atEnd()) {
+                // Translate the choices back to the stones as given
+                result.found = true;
+                result.layout = open[i];
+                auto const &choices = iterator.choices();
+                for (size_t k = 0; k < choices.size(); ++k) {
+                    auto const index = order[choices[k].stone];
+                    Position position = layout.positions()[k];
+                    position.reverse = position.reverse != (choices[k].reverse != flipped[index]);
+                    result.solution.push_back({position, stones_[index]});
+                }
+                return result;
+            }
+            if (!iterator.stopped()) {
+                // No solution in this layout at all
+                open.erase(open.begin() + long(i));
+                continue;
+            }
+            if (result.nodes >= options.maxNodes || (options.cancel && options.cancel->load(memory_order_relaxed)) ||
+                SolveOptions::Time::now() >= options.deadline) {
+                result.complete = false;
+                return result;
+            }
+            ++i;
+        }
+    }
+    return result;
+}
+
+uint64_t FirstSolver::luby(uint64_t i)
+{
+    // Find the finished subsequence of length 2^k - 1 that i lies in
+    uint64_t power = 1;
+    while (power * 2 - 1 < i) {
+        power *= 2;
+    }
+    while (i != power * 2 - 1) {
+        // Skip the repeated prefix
+        i -= power - 1;
+        power = 1;
+        while (power * 2 - 1 < i) {
+            power *= 2;
+        }
+    }
+    return power;
+}
+
+PartialSolver::PartialSolver(const Stones &stones, const Solution &placed)
+    : stones_(stones), placed_(placed)
+{
+    // nothing to do
+}
+
+Hint PartialSolver::find(const SolveOptions &options) const
+{
+    TraceSpan span("PartialSolver::find");
+    MemoryPhase phase(Memory::Solve);
+    Hint result;
+    if (!Solver::isFeasible(stones_, result.reason)) {
+        return result;
+    }
+
+    // Take the placed stones from the stones, which leaves those to place
+    Stones left = stones_;
+    vector<Position> fixed;
+    for (auto const &placed : placed_) {
+        auto const &fields = placed.second.fields;
+        auto const stone = find_if(left.begin(), left.end(), [&fields](const Stone &stone) {
+            return stone.fields == fields || stone.reversed == fields;
+        });
+        if (stone == left.end()) {
+            result.reason = "Stone " + placed.second.value() + " is placed more often than it exists.";
+            return result;
+        }
+        if (placed.first.size != fields.size()) {
+            result.reason = "Stone " + placed.second.value() + " does not match the size of its position.";
+            return result;
+        }
+        left.erase(stone);
+        fixed.push_back(placed.first);
+    }
+
+    vector<size_t> count;
+    if (!LayoutGenerator::sizes(stones_, count)) {
+        result.reason = "Some stone does not fit into the board.";
+        return result;
+    }
+    size_t const size = count.size() - 1;
+    Board board(size);
+    for (auto const &placed : placed_) {
+        if (!board.canAssign(placed.first, placed.second)) {
+            result.reason = "Stone " + placed.second.value() + " leaves the board or covers another one.";
+            return result;
+        }
+        board.assign(placed.first, placed.second);
+    }
+    if (!board.isValid()) {
+        result.reason = "Some color occurs twice in a row or column.";
+        return result;
+    }
+
+    // Only the layouts containing the placed stones are left to search
+    LayoutGenerator::forEach(left, fixed, [&](const Layout &layout) {
+        if (options.nodesLeft(result.nodes) == 0) {
+            result.complete = false;
+            return false;
+        }
+        SolveOptions limited = options;
+        limited.maxNodes = options.nodesLeft(result.nodes);
+        SolutionIterator iterator(layout, left, board, limited);
+        result.nodes += iterator.nodes();
+        if (!iterator.atEnd()) {
+            result.feasible = true;
+            result.placements = iterator.solution();
+            return false;
+        }
+        if (iterator.stopped()) {
+            result.complete = false;
+            return false;
+        }
+        return true;
+    });
+    return result;
+}
+
+LayoutTrie::LayoutTrie(const Layouts &layouts, const Stones &stones)
+    : nodes_(1), stones_(stones.begin(), stones.end())
+{
+    size_t index = 0;
+    for (auto const &layout : layouts) {
+        boardSize_ = layout.boardSize();
+        size_t node = 0;
+        for (auto const &position : layout.positions()) {
+            auto const &children = nodes_[node].children;
+            auto const child = find_if(children.begin(), children.end(), [this, &position](size_t child) {
+                return nodes_[child].position == position;
+            });
+            if (child != children.end()) {
+                node = *child;
+                continue;
+            }
+            nodes_[node].children.push_back(nodes_.size());
+            node = nodes_.size();
+            nodes_.push_back(Node());
+            nodes_.back().position = position;
+        }
+        nodes_[node].layout = index++;
+    }
+}
+
+size_t LayoutTrie::findAssignment(const Callback &callback) const
+{
+    TraceSpan span("LayoutTrie::findAssignment");
+    MemoryPhase phase(Memory::Solve);
+    placements_ = 0;
+    Search state = {Board(boardSize_), vector<bool>(stones_.size(), false), {}, callback, 0};
+    search(0, state);
+    return state.solutions;
+}
+
+uint64_t LayoutTrie::nodes() const
+{
+    return placements_;
+}
+
+size_t LayoutTrie::size() const
+{
+    return nodes_.size() - 1;
+}
+
+void LayoutTrie::search(size_t node, Search &state) const
+{
+    if (nodes_[node].layout != numeric_limits<size_t>::max()) {
+        Solution solution;
+        for (auto const &placement : state.path) {
+            solution.push_back({placement.first, stones_[placement.second]});
+        }
+        ++state.solutions;
+        state.callback(nodes_[node].layout, solution);
+    }
+
+    for (auto const child : nodes_[node].children) {
+        Position position = nodes_[child].position;
+        for (size_t i = 0; i < stones_.size(); ++i) {
+            auto const &stone = stones_[i];
+            if (state.used[i] || stone.fields.size() != position.size) {
+                continue;
+            }
+            for (auto const reverse : {false, true}) {
+                position.reverse = nodes_[child].position.reverse != reverse;
+                ++placements_;
+                if (!state.board.fits(position, stone)) {
+                    continue;
+                }
+                state.board.assign(position, stone);
+                state.used[i] = true;
+                state.path.push_back({position, i});
+                search(child, state);
+                state.path.pop_back();
+                state.used[i] = false;
+                state.board.unassign(position, stone);
+            }
+        }
+    }
+}
+
+LayoutFilter::LayoutFilter(const Stones &stones)
+{
+    string reason;
+    feasible_ = Solver::isFeasible(stones, reason);
+    for (auto const &stone : stones) {
+        auto const kind = find_if(kinds_.begin(), kinds_.end(), [&stone](const Kind &kind) {
+            return kind.fields == stone.fields || kind.fields == stone.reversed;
+        });
+        if (kind != kinds_.end()) {
+            ++kind->count;
+            continue;
+        }
+        Kind added;
+        added.fields = stone.fields;
+        for (auto value : stone.fields) {
+            added.colors |= Palette::mask(value);
+        }
+        added.count = 1;
+        kinds_.push_back(added);
+    }
+}
+
+bool LayoutFilter::accepts(const Layout &layout)
+{
+    ++checked_;
+    if (!feasible_) {
+        ++rejected_;
+        return false;
+    }
+
+    // Rows first, then columns
+    auto const size = layout.boardSize();
+    vector<vector<Piece>> lines(2 * size);
+    for (auto const &position : layout.positions()) {
+        Piece piece;
+        piece.size = position.size;
+        lines[position.horizontal ? position.row : size + position.col].push_back(piece);
+        piece.crossing = true;
+        for (size_t i = 0; i < position.size; ++i) {
+            // Only the distance to the closer end matters, as stones can be reversed
+            piece.offset = min(i, position.size - 1 - i);
+            lines[position.horizontal ? size + position.col + i : position.row + i].push_back(piece);
+        }
+    }
+
+    for (auto &line : lines) {
+        if (!accepts(line)) {
+            ++rejected_;
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t LayoutFilter::checked() const
+{
+    return checked_;
+}
+
+size_t LayoutFilter::rejected() const
+{
+    return rejected_;
+}
+
+bool LayoutFilter::accepts(vector<Piece> &line)
+{
+    // Lying stones restrict the colors most, assign them first
+    sort(line.begin(), line.end(), [](const Piece &a, const Piece &b) {
+        return make_tuple(a.crossing, b.size, a.offset) < make_tuple(b.crossing, a.size, b.offset);
+    });
+    string key;
+    for (auto const &piece : line) {
+        key += char(piece.crossing);
+        key += char(piece.size);
+        key += char(piece.offset);
+    }
+    auto const cached = cache_.find(key);
+    if (cached != cache_.end()) {
+        return cached->second;
+    }
+    return cache_[key] = assign(line, 0, 0);
+}
+
+bool LayoutFilter::assign(const vector<Piece> &line, size_t index, ColorMask colors)
+{
+    if (index == line.size()) {
+        return true;
+    }
+    auto const &piece = line[index];
+    for (auto &kind : kinds_) {
+        if (kind.count == 0 || kind.fields.size() != piece.size) {
+            continue;
+        }
+        --kind.count;
+        bool found = false;
+        if (piece.crossing) {
+            // The stone adds one of the colors at the offset from either end
+            for (auto const value : {kind.fields[piece.offset], kind.fields[piece.size - 1 - piece.offset]}) {
+                auto const color = Palette::mask(value);
+                if (!(colors & color) && assign(line, index + 1, colors | color)) {
+                    found = true;
+                    break;
+                }
+            }
+        } else if (!(colors & kind.colors)) {
+            found = assign(line, index + 1, colors | kind.colors);
+        }
+        ++kind.count;
+        if (found) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool LayoutGenerator::sizes(const Stones &stones, vector<size_t> &count)
 {
     size_t all = 0;
     for (auto const &stone : stones) {
         all += stone.fields.size();
     }
     size_t const board_size = size_t(sqrt(all));
-    vector<size_t> count(board_size+1, 0);
+    count.assign(board_size + 1, 0);
     for (auto const &stone : stones) {
         if (stone.fields.size() > board_size) {
             cerr << "Stone ";
             copy(stone.fields.begin(), stone.fields.end(), ostream_iterator<char>(cerr, ""));
             cerr << " does not fit into the board." << endl;
-            return Layouts();
+            return false;
         }
         ++count[stone.fields.size()];
     }
+    return true;
+}
+
+Layouts LayoutGenerator::findAll(const Stones &stones)
+{
+    vector<size_t> count;
+    if (!sizes(stones, count)) {
+        return Layouts();
+    }
     return findAll(count);
 }
 
+LayoutCount LayoutGenerator::count(const Stones &stones)
+{
+    vector<size_t> count;
+    if (!sizes(stones, count)) {
+        return LayoutCount();
+    }
+    return LayoutGenerator::count(count);
+}
+
+LayoutCount LayoutGenerator::count(const vector<size_t> &stones)
+{
+    size_t all = 0;
+    for (size_t i=1, n=stones.size(); i<n; ++i) {
+        all += i * stones[i];
+    }
+    size_t const board_size = size_t(sqrt(all));
+    if (board_size * board_size != all) {
+        cerr << "Stones do not fit into a squared board." << endl;
+        return LayoutCount();
+    }
+    for (size_t i = board_size + 1; i < stones.size(); ++i) {
+        if (stones[i] > 0) {
+            cerr << "Stones of size " << i << " do not fit into the board." << endl;
+            return LayoutCount();
+        }
+    }
+    vector<size_t> count(board_size + 1, 0);
+    copy(stones.begin() + 1, stones.begin() + long(min(stones.size(), count.size())), count.begin() + 1);
+
+    // The symmetries of the board as cell permutations. Burnside's lemma gives the number of layouts
+    // that are unique under rotation and mirroring as the average number of layouts each of them fixes.
+    auto const symmetry = [board_size](function<size_t(size_t, size_t)> const &map) {
+        vector<size_t> result(board_size * board_size);
+        for (size_t row = 0; row < board_size; ++row) {
+            for (size_t col = 0; col < board_size; ++col) {
+                result[row * board_size + col] = map(row, col);
+            }
+        }
+        return result;
+    };
+    size_t const n = board_size;
+    size_t const last = board_size - 1;
+    auto const identity = symmetry([n](size_t row, size_t col) { return row * n + col; });
+    auto const rotate90 = symmetry([n, last](size_t row, size_t col) { return col * n + last - row; });
+    auto const rotate180 = symmetry([n, last](size_t row, size_t col) { return (last - row) * n + last - col; });
+    auto const flip = symmetry([n, last](size_t row, size_t col) { return (last - row) * n + col; });
+    auto const transpose = symmetry([n](size_t row, size_t col) { return col * n + row; });
+
+    LayoutCount result;
+    result.total = countFixed(count, board_size, identity);
+    // Rotating by 270 degrees fixes the same layouts as rotating by 90 degrees. Likewise both flips and
+    // both diagonal reflections fix the same number of layouts.
+    uint64_t const fixed = result.total + 2 * countFixed(count, board_size, rotate90) +
+                           countFixed(count, board_size, rotate180) + 2 * countFixed(count, board_size, flip) +
+                           2 * countFixed(count, board_size, transpose);
+    assert(fixed % 8 == 0);
+    result.unique = fixed / 8;
+    return result;
+}
+
+uint64_t LayoutGenerator::countFixed(const vector<size_t> &stones, size_t boardSize, const vector<size_t> &symmetry)
+{
+    // Broken profile dynamic programming over the cells in row-major order: The first empty cell is
+    // always covered next, so all cells before it are occupied and the occupied cells after it form the
+    // profile. Together with the stones left it determines the number of ways to complete the board.
+    // Whenever a stone is placed, all its images under the symmetry are placed as well, such that only
+    // layouts fixed by the symmetry are counted.
+    struct Frontier {
+        size_t size;
+        vector<size_t> const &symmetry;
+        string occupied;
+        vector<size_t> count;
+        unordered_map<string, uint64_t> memo;
+
+        uint64_t complete(size_t step)
+        {
+            step = occupied.find('.', step);
+            if (step == string::npos) {
+                return 1;
+            }
+
+            string key = occupied.substr(step);
+            key.append(reinterpret_cast<char const *>(count.data()), count.size() * sizeof(size_t));
+            auto const cached = memo.find(key);
+            if (cached != memo.end()) {
+                return cached->second;
+            }
+
+            uint64_t result = 0;
+            size_t const row = step / size;
+            size_t const col = step % size;
+            vector<size_t> cells;
+            for (size_t k = 1; k <= size; ++k) {
+                if (count[k] == 0) {
+                    continue;
+                }
+                // Stones of size one look the same in both directions
+                for (size_t horizontal = (k == 1 ? 1 : 0); horizontal < 2; ++horizontal) {
+                    if ((horizontal ? col : row) + k > size) {
+                        continue;
+                    }
+                    if (!orbit(step, k, horizontal ? 1 : size, cells) || cells.size() / k > count[k]) {
+                        continue;
+                    }
+                    for (auto cell : cells) {
+                        occupied[cell] = '#';
+                    }
+                    count[k] -= cells.size() / k;
+                    result += complete(step + 1);
+                    count[k] += cells.size() / k;
+                    for (auto cell : cells) {
+                        occupied[cell] = '.';
+                    }
+                }
+            }
+            memo[key] = result;
+            return result;
+        }
+
+        // Collects the cells of a stone and all its images. Fails if they overlap each other or the board
+        bool orbit(size_t start, size_t length, size_t stride, vector<size_t> &cells) const
+        {
+            cells.clear();
+            vector<size_t> stone(length);
+            for (size_t i = 0; i < length; ++i) {
+                stone[i] = start + i * stride;
+            }
+            sort(stone.begin(), stone.end());
+            auto const original = stone;
+            do {
+                for (auto cell : stone) {
+                    if (occupied[cell] != '.' || find(cells.begin(), cells.end(), cell) != cells.end()) {
+                        return false;
+                    }
+                }
+                cells.insert(cells.end(), stone.begin(), stone.end());
+                for (auto &cell : stone) {
+                    cell = symmetry[cell];
+                }
+                sort(stone.begin(), stone.end());
+            } while (stone != original);
+            return true;
+        }
+    };
+
+    Frontier frontier{boardSize, symmetry, string(boardSize * boardSize, '.'), stones, {}};
+    return frontier.complete(0);
+}
+
 Layouts LayoutGenerator::findAll(const vector<size_t> &stones)
 {
+    TraceSpan span("LayoutGenerator::findAll");
+    MemoryPhase phase(Memory::Layouts);
+    Layouts layouts;
+    forEach(stones, [&layouts](const Layout &layout) {
+        layouts.push_back(layout);
+        return true;
+    });
+    return layouts;
+}
+
+bool LayoutGenerator::forEach(const Stones &stones, const Callback &callback)
+{
+    vector<size_t> count;
+    if (!sizes(stones, count)) {
+        return true;
+    }
+    return forEach(count, callback);
+}
+
+bool LayoutGenerator::forEach(const vector<size_t> &stones, const Callback &callback)
+{
+    MemoryPhase phase(Memory::Layouts);
     // Determine board size from stones
     size_t all = 0;
     for (size_t i=1, n=stones.size(); i<n; ++i) {
@@ -468,35 +1642,89 @@ Layouts LayoutGenerator::findAll(const vector<size_t> &stones)
     size_t const board_size = size_t(sqrt(all));
     if (board_size * board_size != all) {
         cerr << "Stones do not fit into a squared board." << endl;
-        return Layouts();
+        return true;
     }
 
     vector<Store> store(board_size + 1);
     for (size_t i = 1; i <= board_size; ++i) {
         store[i].count = i < stones.size() ? stones[i] : 0;
-        store[i].stone = Stone(string(i, 'A'));
+        if (i <= Stone::maxSize) {
+            store[i].stone = Stone(string(i, 'A'));
+        } else if (store[i].count > 0) {
+            // There are no stones this long
+            return true;
+        }
     }
 
-    Layouts layouts;
     vector<Position> layout;
     Board board(board_size);
-    findAll(layouts, layout, board, store, 0);
-    return Layout::unify(layouts);
+    return forEach(callback, layout, board, store, 0, false);
 }
 
-void LayoutGenerator::findAll(Layouts &layouts, vector<Position> &layout, Board &board,
-                              vector<Store> &store, size_t step)
+bool LayoutGenerator::forEach(const Stones &stones, const vector<Position> &fixed, const Callback &callback)
+{
+    MemoryPhase phase(Memory::Layouts);
+    // The fixed positions take part of the board, so sizes() would get the board size wrong
+    vector<size_t> count;
+    size_t all = 0;
+    for (auto const &stone : stones) {
+        auto const size = stone.fields.size();
+        count.resize(max(count.size(), size + 1), 0);
+        ++count[size];
+        all += size;
+    }
+    for (auto const &position : fixed) {
+        all += position.size;
+    }
+    size_t const board_size = size_t(sqrt(all));
+    if (board_size * board_size != all) {
+        return true;
+    }
+
+    vector<Store> store(board_size + 1);
+    for (size_t i = 1; i <= board_size; ++i) {
+        store[i].count = i < count.size() ? count[i] : 0;
+        if (i <= Stone::maxSize) {
+            store[i].stone = Stone(string(i, 'A'));
+        } else if (store[i].count > 0) {
+            // There are no stones this long
+            return true;
+        }
+    }
+
+    if (count.size() > board_size + 1) {
+        // Some stone is larger than the board
+        return true;
+    }
+    Board board(board_size);
+    for (auto const &position : fixed) {
+        Stone const stone(string(position.size, 'A'));
+        if (position.size == 0 || position.size > board_size || !board.canAssign(position, stone)) {
+            // Overlaps another fixed position or leaves the board
+            return true;
+        }
+        board.assign(position, stone);
+    }
+    vector<Position> layout;
+    if (board.isFull()) {
+        return stones.empty() ? callback(Layout(board_size)) : true;
+    }
+    return forEach(callback, layout, board, store, 0, true);
+}
+
+bool LayoutGenerator::forEach(const Callback &callback, vector<Position> &layout, Board &board,
+                              vector<Store> &store, size_t step, bool variants)
 {
     auto const board_size = board.size();
     if (step >= board_size * board_size) {
         // Everything tried, stop recursion
-        return;
+        return true;
     }
     size_t const row = step / board_size;
     size_t const col = step % board_size;
     if (!board.isEmpty(row, col)) {
         // Cannot assign anything here, but a later position might still work
-        findAll(layouts, layout, board, store, step + 1);
+        return forEach(callback, layout, board, store, step + 1, variants);
     }
     for (size_t k = 1; k <= board_size; ++k) {
         auto & reserve = store[k];
@@ -504,31 +1732,68 @@ void LayoutGenerator::findAll(Layouts &layouts, vector<Position> &layout, Board
             // No more stones of this size
             continue;
         }
-        // Recurse into all possible assignments
-        for (size_t horizontal = 0; horizontal < 2; ++horizontal) {
+        // Recurse into all possible assignments. Stones of size one look the same in both directions,
+        // the vertical one comes first and stands for both.
+        for (size_t horizontal = 0; horizontal < (k == 1 ? 1 : 2); ++horizontal) {
             Position const position({k, row, col, bool(horizontal), false});
             if (board.canAssign(position, reserve.stone)) {
                 board.assign(position, reserve.stone);
                 layout.push_back(position);
+                bool proceed = true;
                 if (board.isFull()) {
-                    // Layout is valid, store it
+                    // Layout is valid. Pass it on unless a rotated or mirrored variant of it was found before.
                     Layout result(board.size());
                     for (auto const &pos : layout) {
                         result.add(pos);
                     }
-                    layouts.push_back(result);
+                    proceed = (!variants && !isFirstVariant(result)) || callback(result);
                 }
                 // For horizontal stones some steps can be skipped directly
                 size_t const next_step = step + (horizontal ? k : 1);
                 --reserve.count;
-                findAll(layouts, layout, board, store, next_step);
+                proceed = proceed && forEach(callback, layout, board, store, next_step, variants);
                 // Clean up
                 ++reserve.count;
                 board.unassign(position, store[k].stone);
                 layout.pop_back();
+                if (!proceed) {
+                    return false;
+                }
             }
         }
     }
+    return true;
+}
+
+bool LayoutGenerator::isFirstVariant(const Layout &layout)
+{
+    Layout variant = layout;
+    for (int flip = 0; flip < 2; ++flip) {
+        for (int i = 0; i < 4; ++i) {
+            if (precedes(variant, layout)) {
+                return false;
+            }
+            variant.rotate90();
+        }
+        variant.flipHorizontal();
+    }
+    return true;
+}
+
+bool LayoutGenerator::precedes(const Layout &a, const Layout &b)
+{
+    // The search fills the board cell by cell and tries smaller stones first, vertical before horizontal.
+    // Positions are sorted by their first cell, so comparing them one by one yields the search order.
+    auto const &first = a.positions();
+    auto const &second = b.positions();
+    for (size_t i = 0; i < first.size() && i < second.size(); ++i) {
+        auto const x = 2 * first[i].size + (first[i].size > 1 && first[i].horizontal ? 1 : 0);
+        auto const y = 2 * second[i].size + (second[i].size > 1 && second[i].horizontal ? 1 : 0);
+        if (x != y) {
+            return x < y;
+        }
+    }
+    return false;
 }
 
 Stones &operator<<(Stones &stones, const string &value)
@@ -29,18 +29,97 @@
 #ifndef PUZZLE_H
 #define PUZZLE_H
 
+#include <algorithm>
 #include <cassert>
+#include <cstdint>
+#include <iterator>
 #include <list>
 #include <map>
 #include <vector>
 #include <array>
+#include <atomic>
+#include <chrono>
+#include <functional>
 #include <iostream>
+#include <limits>
+#include <unordered_map>
 
-// A stone that can be set in the game board
+using ColorId = uint8_t;
+using ColorMask = uint64_t;
+
+// A stone that can be set in the game board. Its colors are stored inline, such that copying a stone
+// never allocates.
 struct Stone {
+    // Longest stone supported, which is more than any practical board needs
+    static constexpr size_t maxSize = 16;
+
+    // The colors of a stone in one direction
+    class Fields
+    {
+    public:
+        using iterator = char *;
+        using const_iterator = char const *;
+        using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+        size_t size() const
+        {
+            return size_;
+        }
+        bool empty() const
+        {
+            return size_ == 0;
+        }
+        char operator[](size_t i) const
+        {
+            return data_[i];
+        }
+        iterator begin()
+        {
+            return data_;
+        }
+        iterator end()
+        {
+            return data_ + size_;
+        }
+        const_iterator begin() const
+        {
+            return data_;
+        }
+        const_iterator end() const
+        {
+            return data_ + size_;
+        }
+        const_reverse_iterator rbegin() const
+        {
+            return const_reverse_iterator(end());
+        }
+        const_reverse_iterator rend() const
+        {
+            return const_reverse_iterator(begin());
+        }
+        bool operator==(const Fields &other) const
+        {
+            return size_ == other.size_ && std::equal(begin(), end(), other.begin());
+        }
+        bool operator!=(const Fields &other) const
+        {
+            return !(*this == other);
+        }
+
+    private:
+        friend struct Stone;
+        uint8_t size_ = 0;
+        char data_[maxSize] = {};
+    };
+
+    // Throws std::length_error for values longer than maxSize
     Stone(const std::string &value);
     bool operator==(const Stone &other) const;
-    std::vector<char> fields;
+    Fields fields;
+    // The colors in the other direction
+    Fields reversed;
+    // All colors of the stone
+    ColorMask colors = 0;
     std::string value() const;
 };
 using Stones = std::list<Stone>;
@@ -60,44 +139,39 @@ struct Position {
 using Solution = std::list<std::pair<Position, Stone>>;
 using Solutions = std::list<Solution>;
 
-// Determines if a string consists of unique characters. Extra data structure for performance reasons.
-class Counter
+// The color symbols stones are made of. Each symbol maps to a dense identifier, such that sets of colors
+// fit into a bitset. The common colors come first, so the colors of a puzzle usually get the identifiers
+// 0..N-1.
+class Palette
 {
 public:
-    Counter() = default;
+    static constexpr size_t maxColors = 64;
+    static constexpr ColorId invalid = 0xFF;
 
-    void add(char value)
-    {
-        if (value < min_) {
-            std::cerr << "Character " << value << " is too small, please decrease Counter::min_ field from now " << min_ << " to (at least) " << value << std::endl;
-            exit(3);
-        }
-        size_t const val = size_t(value - min_);
-        if (val >= seen_.size()) {
-            std::cerr << "Character " << value << " is too large, please increase Counter::seen_ field from now " << seen_.size() << " to (at least) " << val + 1 << std::endl;
-            exit(5);
-        }
+    // All symbols, ordered by their identifier
+    static std::string const & symbols();
+    // Display name of a color, e.g. "blue" for B
+    static std::string const & name(char symbol);
+    static bool contains(const std::string &value);
 
-        if (valid_) {
-            if (seen_[val] == true) {
-                valid_ = false;
-            } else {
-                seen_[val] = true;
-            }
-        }
+    static ColorId id(char symbol)
+    {
+        return ids_[uint8_t(symbol)];
     }
-    bool isValid() const
+
+    // Bitset of a single color. Empty for characters that are no color symbol.
+    static ColorMask mask(char symbol)
     {
-        return valid_;
+        return masks_[uint8_t(symbol)];
     }
 
 private:
-    bool valid_ = true;
-    static constexpr char const min_ = '0';
-    std::vector<bool> seen_ = std::vector<bool>(80, false);
+    static std::array<ColorId, 256> const ids_;
+    static std::array<ColorMask, 256> const masks_;
 };
 
-// Game board with a matrix-like data structure
+// Game board with a matrix-like data structure. Tracks the colors of each row and column in bitsets,
+// such that validity checks do not need to look at all cells.
 class Board
 {
 public:
@@ -108,11 +182,6 @@ public:
     explicit Board(size_t size);
     explicit Board(size_t size, const Solution &solution);
 
-    char & at(size_t row, size_t col)
-    {
-        return data_[row][col];
-    }
-
     char at(size_t row, size_t col) const
     {
         return data_.at(row).at(col);
@@ -124,60 +193,84 @@ public:
         assert(row < size_);
         assert(col < size_);
         assert(value == empty_ || data_[row][col] == empty_);
-        data_[row][col] = value;
-        fill_ = (value == empty_ ? fill_ - 1 : fill_ + 1);
+        Cell &cell = data_[row][col];
+        if (value == empty_) {
+            remove(row, col, cell);
+            --fill_;
+        } else {
+            add(row, col, value);
+            ++fill_;
+        }
+        cell = value;
     }
     bool isEmpty(size_t row, size_t col) const;
-    bool canAssign(const Position &position, const Stone &stone) const;
-    void assign(const Position &position, const Stone &stone)
+    // Whether the stone lies within the board and covers empty cells only
+    bool canAssign(const Position &position, const Stone &stone) const
     {
         size_t row = position.row;
         size_t col = position.col;
-        if (position.reverse) {
-            for (int i = int(stone.fields.size()) - 1; i >= 0; --i) {
-                assign(row, col, stone.fields[size_t(i)]);
-                row += position.horizontal ? 0 : 1;
-                col += position.horizontal ? 1 : 0;
-            }
-        } else {
-            for (size_t i = 0, n = stone.fields.size(); i < n; ++i) {
-                assign(row, col, stone.fields[i]);
-                data_[row][col] = stone.fields[i];
-                row += position.horizontal ? 0 : 1;
-                col += position.horizontal ? 1 : 0;
+        for (size_t i = 0, n = stone.fields.size(); i < n; ++i) {
+            if (row >= size_ || col >= size_ || data_[row][col] != empty_) {
+                return false;
             }
+            row += position.horizontal ? 0 : 1;
+            col += position.horizontal ? 1 : 0;
         }
+        return true;
     }
-
-    void unassign(const Position &position, const Stone &stone);
-    bool isValid() const
+    // Determines whether the stone's colors are still missing in all rows and columns it covers. Assumes
+    // that the cells of the position are empty.
+    bool fits(const Position &position, const Stone &stone) const
     {
-        for (size_t row = 0; row < size_; ++row) {
-            Counter counter;
-            for (size_t col = 0; col < size_; ++col) {
-                if (data_[row][col] != empty_) {
-                    counter.add(data_[row][col]);
-                }
-            }
-            if (!counter.isValid()) {
-                return false;
-            }
+        if (stone.colors & (position.horizontal ? rows_[position.row] : cols_[position.col])) {
+            // The line the stone lies in has some of its colors already
+            return false;
         }
-
-        for (size_t col = 0; col < size_; ++col) {
-            Counter counter;
-            for (size_t row = 0; row < size_; ++row) {
-                if (data_[row][col] != empty_) {
-                    counter.add(data_[row][col]);
-                }
-            }
-            if (!counter.isValid()) {
+        auto const &fields = position.reverse ? stone.reversed : stone.fields;
+        size_t row = position.row;
+        size_t col = position.col;
+        ColorMask line = 0;
+        for (auto const value : fields) {
+            auto const color = Palette::mask(value);
+            if ((line & color) || ((position.horizontal ? cols_[col] : rows_[row]) & color)) {
                 return false;
             }
+            line |= color;
+            row += position.horizontal ? 0 : 1;
+            col += position.horizontal ? 1 : 0;
         }
-
         return true;
     }
+    void assign(const Position &position, const Stone &stone)
+    {
+        size_t row = position.row;
+        size_t col = position.col;
+        for (auto const value : position.reverse ? stone.reversed : stone.fields) {
+            assign(row, col, value);
+            row += position.horizontal ? 0 : 1;
+            col += position.horizontal ? 1 : 0;
+        }
+    }
+
+    void unassign(const Position &position, const Stone &stone);
+    ColorMask rowColors(size_t row) const
+    {
+        return rows_[row];
+    }
+    ColorMask colColors(size_t col) const
+    {
+        return cols_[col];
+    }
+    void swapRows(size_t rowA, size_t rowB);
+    void swapCols(size_t colA, size_t colB);
+    // Swaps the colors of two rows in the smallest set of columns that contains the given one and keeps the
+    // colors of both rows unchanged. A valid, full board stays valid. Returns the number of columns swapped.
+    size_t switchCycle(size_t rowA, size_t rowB, size_t col);
+    // No color occurs twice in any row or column
+    bool isValid() const
+    {
+        return conflicts_ == 0;
+    }
     bool isFull() const
     {
         return size_ * size_ == fill_;
@@ -187,10 +280,50 @@ public:
     friend std::ostream& operator<< (std::ostream& stream, const Board& board);
 
 private:
+    void add(size_t row, size_t col, char value)
+    {
+        auto const id = Palette::id(value);
+        assert(id != Palette::invalid);
+        if (id == Palette::invalid) {
+            return;
+        }
+        auto const color = ColorMask(1) << id;
+        auto &inRow = counts_[row * Palette::maxColors + id];
+        auto &inCol = counts_[(size_ + col) * Palette::maxColors + id];
+        conflicts_ += (inRow > 0 ? 1 : 0) + (inCol > 0 ? 1 : 0);
+        ++inRow;
+        ++inCol;
+        rows_[row] |= color;
+        cols_[col] |= color;
+    }
+
+    void remove(size_t row, size_t col, char value)
+    {
+        auto const id = Palette::id(value);
+        if (id == Palette::invalid) {
+            return;
+        }
+        auto const color = ColorMask(1) << id;
+        auto &inRow = counts_[row * Palette::maxColors + id];
+        auto &inCol = counts_[(size_ + col) * Palette::maxColors + id];
+        --inRow;
+        --inCol;
+        conflicts_ -= (inRow > 0 ? 1 : 0) + (inCol > 0 ? 1 : 0);
+        rows_[row] &= inRow > 0 ? ~ColorMask(0) : ~color;
+        cols_[col] &= inCol > 0 ? ~ColorMask(0) : ~color;
+    }
+
     Cell const empty_ = ' ';
     Matrix data_;
     size_t size_;
     size_t fill_ = 0;
+    // Colors present in each row and column
+    std::vector<ColorMask> rows_;
+    std::vector<ColorMask> cols_;
+    // Occurrences of each color in each row, followed by those in each column
+    std::vector<uint8_t> counts_;
+    // Colors occurring more than once in a row or column
+    size_t conflicts_ = 0;
 };
 
 // A set of possible assigments of stones to the board, where stone colors are ignored
@@ -202,6 +335,8 @@ public:
     void add(const Position & position);
     bool isFull() const;
     std::vector<Position> const & positions() const;
+    // Drops layouts that are rotated or mirrored versions of earlier ones. LayoutGenerator avoids those while
+    // searching, so this slow pairwise comparison remains as a check of its results only.
     static std::list<Layout> unify(const std::list<Layout> &layouts);
     std::string signature() const;
     void rotate90();
@@ -212,6 +347,7 @@ public:
 
 private:
     void rotate90(size_t &row, size_t &col) const;
+    void paint(std::string &grid, const Position &position, char value) const;
     void normalize();
     bool operator<(const Layout & other) const;
 
@@ -221,37 +357,370 @@ private:
 };
 using Layouts = std::list<Layout>;
 
+// A deterministic part of the search space, such that a search can be split across processes. A branch
+// of the search belongs to a shard based on the layout and the first placements made in it.
+struct Shard {
+    size_t index = 0;
+    size_t count = 1;
+    // Number of placements that identify a branch
+    size_t depth = 2;
+    // Index of the layout searched
+    size_t layout = 0;
+};
+
+// Limits of a solution search. The search stops early when any of them is reached.
+struct SolveOptions {
+    using Time = std::chrono::steady_clock;
+
+    // Point in time to stop at
+    Time::time_point deadline = Time::time_point::max();
+    // Number of placements to try at most
+    uint64_t maxNodes = std::numeric_limits<uint64_t>::max();
+    // Stops the search once set, e.g. from a different thread
+    std::atomic<bool> const * cancel = nullptr;
+    // Searches only the branches belonging to this shard
+    Shard shard;
+
+    // Placements left after the given ones were tried. A search may try a few more placements than allowed
+    // before noticing, so this never goes below zero.
+    uint64_t nodesLeft(uint64_t used) const
+    {
+        return used < maxNodes ? maxNodes - used : 0;
+    }
+};
+
+// Depth-first search for the solutions of a layout. The search state lives in an explicit stack, such that
+// the search is suspended after each solution and resumes when the next one is requested.
+class SolutionIterator
+{
+public:
+    // The stone placed at a layout position and its direction
+    struct Choice {
+        size_t stone = 0;
+        bool reverse = false;
+    };
+
+    // Search progress: The choices made for the first layout positions and the choice to try next
+    struct State {
+        std::vector<Choice> path;
+        Choice cursor;
+    };
+
+    SolutionIterator(const Layout & layout, const Stones & stones, const SolveOptions & options = SolveOptions());
+    // Continues the search from a previously saved state. Nothing is searched until next() is called.
+    SolutionIterator(const Layout & layout, const Stones & stones, const State & state,
+                     const SolveOptions & options = SolveOptions());
+    // Places the stones on a board that is partly filled already. The layout covers the empty cells.
+    SolutionIterator(const Layout & layout, const Stones & stones, const Board & board,
+                     const SolveOptions & options = SolveOptions());
+
+    // No more solutions follow, either because all were found or because the search was stopped
+    bool atEnd() const;
+    // The search ended early because a limit of its options was reached
+    bool stopped() const;
+    // The current solution. Built on first access only.
+    Solution const & solution() const;
+    // The stones and directions of the current solution, in layout order
+    std::vector<Choice> const & choices() const;
+    void next();
+    // Like next(), but suspends the search after trying the given number of placements. Returns false
+    // if suspended; call it again to continue the search.
+    bool next(uint64_t nodes);
+    // Placements tried so far
+    uint64_t nodes() const;
+    // The state to continue the search from after the current solution
+    State state() const;
+    // Whether a state, e.g. one read from a file, belongs to a search of the layout with the stones: Each
+    // stone is used once at most, fits its position and the cursor is a valid choice
+    static bool isValid(const Layout & layout, const Stones & stones, const State & state);
+    // The placements of the deepest branch searched so far
+    Solution best() const;
+    // Estimates the placements a search from the current branch tries, using Knuth's method: Each probe
+    // descends along random choices and multiplies the number of choices on its way. The average over the
+    // probes is an unbiased estimate of the search tree size. Leaves the search state as it is.
+    double estimate(size_t probes, uint64_t seed = 0);
+
+private:
+    bool search(uint64_t limit);
+    bool limitReached() const;
+    bool inShard(const Choice & choice) const;
+    bool place(Choice cursor);
+    Choice remove();
+    static Choice following(const Choice & choice);
+    Position position(size_t layoutIndex, const Choice & choice) const;
+    void prepare();
+    void take(size_t stone);
+    void putBack(size_t stone);
+    bool canComplete() const;
+
+    Layout layout_;
+    std::vector<Stone> stones_;
+    std::vector<bool> used_;
+    // Colors every row and column needs. Empty if the stones do not have as many colors as the board is large.
+    ColorMask palette_ = 0;
+    // The distinct stone sizes
+    std::vector<size_t> sizes_;
+    // Sizes of the positions not assigned yet that cross each row and column, for each search depth
+    std::vector<uint64_t> crossing_;
+    // Colors of the stones left, for each stone size, and how often each of them occurs
+    std::vector<ColorMask> supply_;
+    std::vector<size_t> supplyCounts_;
+    std::vector<Choice> path_;
+    std::vector<Choice> best_;
+    Choice cursor_;
+    Board board_;
+    mutable Solution solution_;
+    SolveOptions options_;
+    uint64_t nodes_ = 0;
+    // Node count at which the limits of the options are checked next
+    uint64_t check_ = 0;
+    bool found_ = false;
+    bool atEnd_ = false;
+    bool stopped_ = false;
+};
+
+// The solutions of one layout in a contiguous arena. Each placement is stored as the index of its stone and
+// the direction, which takes one byte for up to 128 stones. Solutions are decoded on access.
+class SolutionStore
+{
+public:
+    SolutionStore(const Layout & layout, const Stones & stones);
+
+    void add(const std::vector<SolutionIterator::Choice> & choices);
+    size_t size() const;
+    bool empty() const;
+    // Memory used by the encoded solutions
+    size_t bytes() const;
+    Layout const & layout() const;
+
+    SolutionIterator::Choice choice(size_t index, size_t placement) const;
+    Solution solution(size_t index) const;
+    Board board(size_t index) const;
+
+private:
+    Layout layout_;
+    std::vector<Stone> stones_;
+    // Bytes per placement
+    size_t width_ = 1;
+    size_t size_ = 0;
+    std::vector<uint8_t> data_;
+};
+
+// Outcome of a solution search with limits
+struct SolveResult {
+    Solutions solutions;
+    // False if the search stopped early, such that more solutions might exist
+    bool complete = true;
+    // The most stones placed in any branch of the search
+    Solution best;
+    // Placements tried
+    uint64_t nodes = 0;
+};
+
 // Brute force solution search for a given layout and a given set of stones
 class Solver
 {
 public:
     Solver(const Layout & layout, const Stones & stones);
     Solutions findAssignment() const;
+    SolveResult findAssignment(const SolveOptions & options) const;
+    // Like findAssignment(), but keeps the solutions compactly
+    SolutionStore findAll() const;
+    SolutionIterator begin() const;
     static void printSolution(const Solution & solution);
+    // Cheap checks whether the stones can form a valid board at all. Fills in the reason if not.
+    static bool isFeasible(const Stones & stones, std::string & reason);
 
 private:
-    void findAssignment(Solutions &solutions, Board & board, Stones & stones, size_t layoutIndex,
-                        Solution & solution) const;
-
     Layout layout_;
     Stones stones_;
 };
 
+// Outcome of a search for a single solution of any layout
+struct FirstSolution {
+    bool found = false;
+    // False if the search stopped early, such that a solution might exist although none was found
+    bool complete = true;
+    // Index of the layout solved
+    size_t layout = 0;
+    Solution solution;
+    // Placements tried
+    uint64_t nodes = 0;
+    size_t restarts = 0;
+};
+
+// Looks for a single solution of any layout. Each run tries the layouts and stones in a random order and
+// direction. Runs give up after a number of placements that grows with the Luby sequence, and the search
+// restarts with a new order. Restarts even out the runtime of unlucky orders. Layouts searched completely
+// without a solution are not searched again.
+class FirstSolver
+{
+public:
+    FirstSolver(const Layouts & layouts, const Stones & stones, uint64_t seed = 0);
+    // Placements per layout in the shortest run
+    void setCutoff(uint64_t placements);
+    // Stops at the limits of the options, except for the shard
+    FirstSolution find(const SolveOptions & options = SolveOptions()) const;
+    // The i-th element of the Luby sequence 1 1 2 1 1 2 4 1 1 2 1 1 2 4 8 ..., starting at i = 1
+    static uint64_t luby(uint64_t i);
+
+private:
+    std::vector<Layout> layouts_;
+    std::vector<Stone> stones_;
+    uint64_t seed_;
+    uint64_t cutoff_ = 1 << 12;
+};
+
+// Whether a partly filled board can still be completed, and how
+struct Hint {
+    bool feasible = false;
+    // False if the search stopped early, such that the board might be completed although no way was found
+    bool complete = true;
+    // The placements completing the board, starting with the one covering the first empty cell
+    Solution placements;
+    // Why the placed stones cannot be part of a solution, if that is obvious without a search
+    std::string reason;
+    // Placements tried
+    uint64_t nodes = 0;
+};
+
+// Answers whether stones placed on a board so far still lead to a solution, e.g. to give hints to a player.
+// Only layouts that contain the placed stones are searched, on a board that has them placed already.
+class PartialSolver
+{
+public:
+    // The placed stones are among the stones, in either direction
+    PartialSolver(const Stones & stones, const Solution & placed);
+    // Stops at the limits of the options, except for the shard
+    Hint find(const SolveOptions & options = SolveOptions()) const;
+
+private:
+    Stones stones_;
+    Solution placed_;
+};
+
+// Searches the solutions of many layouts at once. The layouts are stored in a trie keyed by their
+// positions, such that layouts starting with the same positions share the search of these placements.
+class LayoutTrie
+{
+public:
+    // Receives the index of the layout and a solution of it
+    using Callback = std::function<void(size_t, const Solution &)>;
+
+    LayoutTrie(const Layouts & layouts, const Stones & stones);
+    // Calls back for each solution of each layout. Returns the number of solutions.
+    size_t findAssignment(const Callback & callback) const;
+    // Placements tried in the last search
+    uint64_t nodes() const;
+    // Number of positions in the trie
+    size_t size() const;
+
+private:
+    struct Node {
+        Position position;
+        std::vector<size_t> children;
+        // Index of the layout ending here, if any
+        size_t layout = std::numeric_limits<size_t>::max();
+    };
+
+    struct Search {
+        Board board;
+        std::vector<bool> used;
+        std::vector<std::pair<Position, size_t>> path;
+        Callback const & callback;
+        size_t solutions = 0;
+    };
+
+    void search(size_t node, Search & search) const;
+
+    std::vector<Node> nodes_;
+    std::vector<Stone> stones_;
+    size_t boardSize_ = 0;
+    mutable uint64_t placements_ = 0;
+};
+
+// Cheap necessary conditions for a layout to have a solution. Every row receives each color once, so the
+// stones lying in a row need disjoint colors, and the stones crossing it must add the missing ones. The same
+// holds for columns. Lines made of the same pieces share the outcome, which is cached across layouts.
+class LayoutFilter
+{
+public:
+    explicit LayoutFilter(const Stones & stones);
+    // False if the layout has no solution for the stones. True does not guarantee a solution.
+    bool accepts(const Layout & layout);
+    size_t checked() const;
+    size_t rejected() const;
+
+private:
+    // A stone lying in a row or column, or crossing it at the given offset
+    struct Piece {
+        size_t size = 0;
+        size_t offset = 0;
+        bool crossing = false;
+    };
+
+    // Stones with equal colors in equal order are interchangeable
+    struct Kind {
+        Stone::Fields fields;
+        ColorMask colors = 0;
+        size_t count = 0;
+    };
+
+    bool accepts(std::vector<Piece> & line);
+    bool assign(const std::vector<Piece> & line, size_t index, ColorMask colors);
+
+    std::vector<Kind> kinds_;
+    std::unordered_map<std::string, bool> cache_;
+    bool feasible_ = false;
+    size_t checked_ = 0;
+    size_t rejected_ = 0;
+};
+
+// Number of layouts for a set of stone sizes
+struct LayoutCount {
+    // Distinct tilings of the board
+    uint64_t total = 0;
+    // Tilings that are distinct under rotation and mirroring, i.e. what LayoutGenerator::findAll returns
+    uint64_t unique = 0;
+};
+
 // Brute force layout search
 class LayoutGenerator
 {
 public:
+    // Receives each layout found. Returning false stops the search.
+    using Callback = std::function<bool(const Layout &)>;
+
     static Layouts findAll(const std::vector<size_t> &stones);
     static Layouts findAll(const Stones & stones);
 
+    // Like findAll, but passes the layouts on one at a time while searching, in the same order. Returns
+    // false if the callback stopped the search.
+    static bool forEach(const std::vector<size_t> &stones, const Callback &callback);
+    static bool forEach(const Stones & stones, const Callback &callback);
+    // Passes on the layouts of the stones that complete the fixed positions, leaving out the fixed positions
+    // themselves. Rotated and mirrored variants are passed on as well, since the fixed positions tell them apart.
+    static bool forEach(const Stones & stones, const std::vector<Position> &fixed, const Callback &callback);
+
+    // Counts layouts without enumerating them
+    static LayoutCount count(const std::vector<size_t> &stones);
+    static LayoutCount count(const Stones & stones);
+
+    // Number of stones of each size, indexed by size. False if a stone is larger than the board.
+    static bool sizes(const Stones &stones, std::vector<size_t> &count);
+
 private:
     struct Store {
         Stone stone = Stone(std::string());
         size_t count = 0;
     };
 
-    static void findAll(Layouts & layouts, std::vector<Position> & layout, Board & board,
-                        std::vector<Store> & store, size_t step);
+    static bool forEach(const Callback & callback, std::vector<Position> & layout, Board & board,
+                        std::vector<Store> & store, size_t step, bool variants);
+    static bool isFirstVariant(const Layout & layout);
+    static bool precedes(const Layout & a, const Layout & b);
+    static uint64_t countFixed(const std::vector<size_t> &stones, size_t boardSize,
+                               const std::vector<size_t> &symmetry);
 };
 
 #endif
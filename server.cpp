@@ -0,0 +1,302 @@
+// Copyright 2018 Dennis Nienhüser
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "cache.h"
+#include "puzzle.h"
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// Layouts for each histogram of stone sizes, shared by all requests
+class LayoutCache
+{
+public:
+    shared_ptr<Layouts const> find(const vector<size_t> &sizes)
+    {
+        {
+            lock_guard<mutex> guard(lock_);
+            auto const cached = layouts_.find(sizes);
+            if (cached != layouts_.end()) {
+                return cached->second;
+            }
+        }
+        // Generating layouts takes long, do not block other requests meanwhile
+        shared_ptr<Layouts const> const layouts = make_shared<Layouts>(LayoutGenerator::findAll(sizes));
+        lock_guard<mutex> guard(lock_);
+        return layouts_.insert({sizes, layouts}).first->second;
+    }
+
+private:
+    mutex lock_;
+    map<vector<size_t>, shared_ptr<Layouts const>> layouts_;
+};
+
+// Connections waiting for a worker
+class Queue
+{
+public:
+    void push(int connection)
+    {
+        {
+            lock_guard<mutex> guard(lock_);
+            connections_.push_back(connection);
+        }
+        ready_.notify_one();
+    }
+
+    int pop()
+    {
+        unique_lock<mutex> guard(lock_);
+        ready_.wait(guard, [this] { return !connections_.empty(); });
+        int const connection = connections_.front();
+        connections_.pop_front();
+        return connection;
+    }
+
+private:
+    mutex lock_;
+    condition_variable ready_;
+    deque<int> connections_;
+};
+
+static bool send(int connection, const string &data)
+{
+    size_t sent = 0;
+    while (sent < data.size()) {
+        auto const result = ::send(connection, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (result <= 0) {
+            return false;
+        }
+        sent += size_t(result);
+    }
+    return true;
+}
+
+// Answers a request of the form [OPTIONS] STONE1 STONE2 ... with one line per solution returned, followed
+// by a summary line
+static string solve(const string &request, LayoutCache &cache, ResultCache &results)
+{
+    using Time = SolveOptions::Time;
+
+    SolveOptions options;
+    size_t limit = numeric_limits<size_t>::max();
+    Stones stones;
+    istringstream tokens(request);
+    string token;
+    try {
+        while (tokens >> token) {
+            if (token == "--timeout" && tokens >> token) {
+                auto const timeout = chrono::duration<double>(stod(token));
+                options.deadline = Time::now() + chrono::duration_cast<Time::duration>(timeout);
+            } else if (token == "--max-nodes" && tokens >> token) {
+                options.maxNodes = stoull(token);
+            } else if (token == "--solutions" && tokens >> token) {
+                limit = stoull(token);
+            } else if (token.compare(0, 2, "--") == 0) {
+                return "error Unknown or incomplete option " + token + "\n";
+            } else if (!Palette::contains(token)) {
+                return "error Stone " + token + " contains characters other than the supported colors " + Palette::symbols() + "\n";
+            } else if (token.size() > Stone::maxSize) {
+                return "error Stone " + token + " is longer than the maximum of " + to_string(Stone::maxSize) + " colors\n";
+            } else {
+                stones << token;
+            }
+        }
+    } catch (const exception &) {
+        return "error Invalid number " + token + "\n";
+    }
+    if (stones.empty()) {
+        return "error No stones given\n";
+    }
+
+    string reason;
+    vector<size_t> sizes;
+    if (!Solver::isFeasible(stones, reason)) {
+        // Error lines carry no final period
+        return "error " + reason.substr(0, reason.find_last_not_of('.') + 1) + "\n";
+    }
+    if (!LayoutGenerator::sizes(stones, sizes)) {
+        return "error Some stone does not fit into the board\n";
+    }
+
+    string response;
+    size_t const size = sizes.size() - 1;
+    // Puzzles asked for before are answered from the results, whatever the colors are named
+    CanonicalStones const puzzle(stones);
+    Solutions found;
+    size_t count = 0;
+    if (results.find(puzzle, count, found, limit)) {
+        for (auto const &solution : found) {
+            response += "solution " + Board(size, solution).signature() + "\n";
+        }
+        return response + "found " + to_string(count) + " complete\n";
+    }
+
+    size_t solutions = 0;
+    uint64_t nodes = 0;
+    bool stopped = false;
+    auto const maxNodes = options.maxNodes;
+    LayoutFilter filter(stones);
+    for (auto const &layout : *cache.find(sizes)) {
+        if (!filter.accepts(layout)) {
+            continue;
+        }
+        options.maxNodes = maxNodes;
+        if (options.nodesLeft(nodes) == 0) {
+            stopped = true;
+            break;
+        }
+        options.maxNodes = options.nodesLeft(nodes);
+        SolutionIterator iterator(layout, stones, options);
+        for (; !iterator.atEnd(); iterator.next()) {
+            if (solutions++ < limit) {
+                response += "solution " + Board(layout.boardSize(), iterator.solution()).signature() + "\n";
+            }
+            if (found.size() <= ResultCache::maxSolutions) {
+                // One more than kept marks the puzzle as too large to keep
+                found.push_back(iterator.solution());
+            }
+        }
+        nodes += iterator.nodes();
+        if (iterator.stopped()) {
+            stopped = true;
+            break;
+        }
+    }
+    if (!stopped) {
+        results.insert(puzzle, found);
+    }
+    return response + "found " + to_string(solutions) + (stopped ? " stopped\n" : " complete\n");
+}
+
+// Longest request line accepted. Clients sending more without a newline are dropped.
+static size_t const maxRequestLength = 64 * 1024;
+
+static void serve(Queue &queue, LayoutCache &cache, ResultCache &results)
+{
+    while (true) {
+        int const connection = queue.pop();
+        string pending;
+        char data[4096];
+        ssize_t received;
+        bool connected = true;
+        while (connected && (received = recv(connection, data, sizeof(data), 0)) > 0) {
+            pending.append(data, size_t(received));
+            size_t end;
+            while (connected && (end = pending.find('\n')) != string::npos) {
+                auto const request = pending.substr(0, end);
+                pending.erase(0, end + 1);
+                connected = send(connection, solve(request, cache, results));
+            }
+            if (connected && pending.size() > maxRequestLength) {
+                send(connection, "error Request exceeds " + to_string(maxRequestLength) + " bytes\n");
+                connected = false;
+            }
+        }
+        close(connection);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    string path;
+    size_t threads = max(1u, thread::hardware_concurrency());
+    for (int i = 1; i < argc; ++i) {
+        string const arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) {
+            threads = max(1ull, stoull(argv[++i]));
+        } else {
+            path = arg;
+        }
+    }
+    if (path.empty()) {
+        cout << "Usage: " << argv[0] << " [--threads N] SOCKET\n";
+        cout << "Listens on the Unix domain socket SOCKET for puzzles, one per line:\n";
+        cout << "  [--timeout SECONDS] [--max-nodes N] [--solutions N] STONE1 STONE2 ...\n";
+        cout << "Answers each with a line 'solution BOARD' for each of the first N solutions (default: all),\n";
+        cout << "followed by 'found COUNT complete', 'found COUNT stopped' if a limit was reached, or 'error MESSAGE'." << endl;
+        return 0;
+    }
+
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        cerr << "Socket path '" << path << "' is too long." << endl;
+        return 1;
+    }
+    strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+    // Only a stale socket of an earlier run is replaced, never a file given by mistake
+    struct stat status;
+    if (lstat(path.c_str(), &status) == 0) {
+        if (!S_ISSOCK(status.st_mode)) {
+            cerr << "Unable to listen on socket '" << path << "': The path exists and is no socket." << endl;
+            return 1;
+        }
+        unlink(path.c_str());
+    }
+    int const server = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server < 0 || ::bind(server, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(server, 64) != 0) {
+        cerr << "Unable to listen on socket '" << path << "': " << strerror(errno) << endl;
+        return 1;
+    }
+
+    Queue queue;
+    LayoutCache cache;
+    ResultCache results;
+    vector<thread> workers;
+    for (size_t i = 0; i < threads; ++i) {
+        workers.emplace_back(serve, ref(queue), ref(cache), ref(results));
+    }
+    cout << "Listening on " << path << " with " << threads << " worker(s)." << endl;
+    while (true) {
+        int const connection = accept(server, nullptr, nullptr);
+        if (connection >= 0) {
+            queue.push(connection);
+        }
+    }
+}
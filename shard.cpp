@@ -0,0 +1,116 @@
+// Copyright 2018 Dennis Nienhüser
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "shard.h"
+#include "statefile.h"
+
+#include <fstream>
+
+using namespace std;
+
+static string const magic = "five-colors-shard";
+static int const version = 1;
+
+bool ShardResult::save(const string &filename) const
+{
+    return StateFile::save(filename, magic, version, stones, shard, [this](ostream &file) {
+        file << "solutions " << solutions << '\n';
+        file << "complete " << complete << '\n';
+        file << "boards " << boards.size() << '\n';
+        for (auto const &board : boards) {
+            file << board << '\n';
+        }
+    });
+}
+
+bool ShardResult::load(const string &filename)
+{
+    ifstream file(filename);
+    if (!StateFile::load(file, magic, version, stones, shard)) {
+        return false;
+    }
+
+    string key;
+    size_t count = 0;
+    if (!(file >> key >> solutions) || key != "solutions" ||
+        !(file >> key >> complete) || key != "complete" ||
+        !(file >> key >> count) || key != "boards") {
+        return false;
+    }
+    boards.clear();
+    for (string board; boards.size() < count && file >> board; ) {
+        boards.push_back(board);
+    }
+    return boards.size() == count;
+}
+
+bool ShardResult::merge(const vector<ShardResult> &results, ShardResult &merged, string &error)
+{
+    if (results.empty()) {
+        error = "No shard results given.";
+        return false;
+    }
+
+    merged = ShardResult();
+    merged.stones = results.front().stones;
+    merged.shard = results.front().shard;
+    if (merged.shard.count != results.size()) {
+        // Checked first, as the count read from the file must not decide how much memory is needed
+        error = "Expected " + to_string(merged.shard.count) + " shard results, got " + to_string(results.size()) + ".";
+        return false;
+    }
+    vector<bool> seen(merged.shard.count, false);
+    for (auto const &result : results) {
+        if (result.stones != merged.stones) {
+            error = "Shards belong to searches for different stones.";
+            return false;
+        }
+        if (result.shard.count != merged.shard.count || result.shard.depth != merged.shard.depth) {
+            error = "Shards belong to differently split searches.";
+            return false;
+        }
+        if (result.shard.index >= seen.size() || seen[result.shard.index]) {
+            error = "Shard " + to_string(result.shard.index) + " occurs more than once or is out of range.";
+            return false;
+        }
+        seen[result.shard.index] = true;
+        merged.solutions += result.solutions;
+        merged.complete = merged.complete && result.complete;
+        merged.boards.insert(merged.boards.end(), result.boards.begin(), result.boards.end());
+    }
+
+    for (size_t i = 0; i < seen.size(); ++i) {
+        if (!seen[i]) {
+            error = "Shard " + to_string(i) + " of " + to_string(seen.size()) + " is missing.";
+            return false;
+        }
+    }
+    merged.shard.index = 0;
+    merged.shard.count = 1;
+    return true;
+}
@@ -0,0 +1,57 @@
+// Copyright 2018 Dennis Nienhüser
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef SHARD_H
+#define SHARD_H
+
+#include "puzzle.h"
+
+#include <string>
+#include <vector>
+
+// Outcome of searching a single shard. Stored in a file, such that the results of all shards of a search
+// can be merged later on.
+struct ShardResult {
+    // The stones searched for, in the order given
+    std::vector<std::string> stones;
+    Shard shard;
+    size_t solutions = 0;
+    // False if the search of the shard stopped early
+    bool complete = true;
+    // Signatures of the boards solved, if requested
+    std::vector<std::string> boards;
+
+    bool save(const std::string &filename) const;
+    bool load(const std::string &filename);
+
+    // Combines the results of all shards of one search. Fails if a shard is missing, occurs twice or
+    // belongs to a different search.
+    static bool merge(const std::vector<ShardResult> &results, ShardResult &merged, std::string &error);
+};
+
+#endif
@@ -26,29 +26,548 @@
 // ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
 // POSSIBILITY OF SUCH DAMAGE.
 
+#include "cache.h"
+#include "checkpoint.h"
+#include "latin.h"
+#include "memory.h"
+#include "portfolio.h"
+#include "progress.h"
 #include "puzzle.h"
+#include "shard.h"
+#include "trace.h"
+#include "writer.h"
 
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <fstream>
 #include <iostream>
+#include <limits>
+#include <memory>
 
 using namespace std;
 
+int merge(int argc, char* argv[])
+{
+    vector<ShardResult> results;
+    for (int i = 2; i < argc; ++i) {
+        ShardResult result;
+        if (!result.load(argv[i])) {
+            cerr << "Unable to read shard result file '" << argv[i] << "'." << endl;
+            return 1;
+        }
+        results.push_back(result);
+    }
+
+    ShardResult merged;
+    string error;
+    if (!ShardResult::merge(results, merged, error)) {
+        cerr << error << endl;
+        return 1;
+    }
+    for (auto const &board : merged.boards) {
+        cout << board << '\n';
+    }
+    if (!merged.complete) {
+        cout << "Found " << merged.solutions << " solution(s) so far, some shards stopped early." << endl;
+        return 2;
+    }
+    cout << "Found " << merged.solutions << " solution(s) in total." << endl;
+    return 0;
+}
+
+// Saves the recorded spans when leaving main, whichever way that happens
+struct TraceFile {
+    std::string file;
+
+    ~TraceFile()
+    {
+        if (!file.empty() && !Trace::save(file)) {
+            cerr << "Failed to write trace file '" << file << "'." << endl;
+        }
+    }
+};
+
+// Prints the allocation statistics when leaving main
+struct MemoryReport {
+    bool enabled = false;
+
+    ~MemoryReport()
+    {
+        if (enabled) {
+            Memory::report(cerr);
+        }
+    }
+};
+
 int main(int argc, char* argv[])
 {
+    using Time = std::chrono::steady_clock;
+
+    if (argc > 1 && string(argv[1]) == "merge") {
+        return merge(argc, argv);
+    }
+
+    Checkpoint checkpoint;
+    string checkpoint_file;
+    bool resume = false;
+    std::chrono::seconds interval(60);
+    SolveOptions options;
+    uint64_t max_nodes = numeric_limits<uint64_t>::max();
+    ShardResult shard_result;
+    string shard_file;
+    bool shard_solutions = false;
+    string output_file;
+    SolutionWriter::Format format = SolutionWriter::Format::Text;
+    bool trie = false;
+    bool latin = false;
+    bool first = false;
+    bool exists = false;
+    size_t threads = 1;
+    uint64_t seed = 0;
+    TraceFile trace;
+    MemoryReport memory;
+    std::chrono::seconds progress_interval(0);
+    string status_file;
+    string cache_file;
     Stones stones;
     for (int i=1; i<argc; ++i) {
-        stones << argv[i];
+        string const arg = argv[i];
+        if (arg == "--checkpoint" && i + 1 < argc) {
+            checkpoint_file = argv[++i];
+        } else if (arg == "--checkpoint-interval" && i + 1 < argc) {
+            interval = std::chrono::seconds(stoull(argv[++i]));
+        } else if (arg == "--resume") {
+            resume = true;
+        } else if (arg == "--timeout" && i + 1 < argc) {
+            auto const timeout = std::chrono::duration<double>(stod(argv[++i]));
+            options.deadline = Time::now() + std::chrono::duration_cast<Time::duration>(timeout);
+        } else if (arg == "--max-nodes" && i + 1 < argc) {
+            max_nodes = stoull(argv[++i]);
+        } else if (arg == "--shard" && i + 1 < argc) {
+            string const shard = argv[++i];
+            auto const separator = shard.find('/');
+            if (separator == string::npos) {
+                cerr << "Invalid shard '" << shard << "', expected e.g. 0/4 for the first of four shards." << endl;
+                return 1;
+            }
+            options.shard.index = stoull(shard.substr(0, separator));
+            options.shard.count = stoull(shard.substr(separator + 1));
+            if (options.shard.count == 0 || options.shard.index >= options.shard.count) {
+                cerr << "Invalid shard '" << shard << "', the index must be less than the number of shards." << endl;
+                return 1;
+            }
+        } else if (arg == "--shard-depth" && i + 1 < argc) {
+            options.shard.depth = stoull(argv[++i]);
+        } else if (arg == "--shard-result" && i + 1 < argc) {
+            shard_file = argv[++i];
+        } else if (arg == "--shard-solutions") {
+            shard_solutions = true;
+        } else if (arg == "--output" && i + 1 < argc) {
+            output_file = argv[++i];
+        } else if (arg == "--format" && i + 1 < argc) {
+            if (!SolutionWriter::parse(argv[++i], format)) {
+                cerr << "Unknown output format '" << argv[i] << "', expected text, jsonl or binary." << endl;
+                return 1;
+            }
+        } else if (arg == "--trie") {
+            trie = true;
+        } else if (arg == "--latin") {
+            latin = true;
+        } else if (arg == "--first") {
+            first = true;
+        } else if (arg == "--exists") {
+            first = true;
+            exists = true;
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threads = max(1ull, stoull(argv[++i]));
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seed = stoull(argv[++i]);
+        } else if (arg == "--trace" && i + 1 < argc) {
+            trace.file = argv[++i];
+            Trace::enable();
+        } else if (arg == "--progress" && i + 1 < argc) {
+            progress_interval = std::chrono::seconds(max(1ull, stoull(argv[++i])));
+        } else if (arg == "--status" && i + 1 < argc) {
+            status_file = argv[++i];
+        } else if (arg == "--cache" && i + 1 < argc) {
+            cache_file = argv[++i];
+        } else if (arg == "--mem-stats") {
+            memory.enabled = true;
+        } else {
+            checkpoint.stones.push_back(arg);
+        }
     }
-    if (stones.empty()) {
-        cout << "Usage: " << argv[0] << " STONE1 STONE2 STONE3 ...\n";
+    if (checkpoint.stones.empty()) {
+        cout << "Usage: " << argv[0] << " [OPTIONS] STONE1 STONE2 STONE3 ...\n";
+        cout << "       " << argv[0] << " merge SHARD_RESULT1 SHARD_RESULT2 ...\n";
         cout << "A STONE is a string where each character represents a certain color, e.g. GRB for green red blue.\n";
-        cout << "Pass e.g. GRB BGR RBG for a 3x3 board." << endl;
+        cout << "Pass e.g. GRB BGR RBG for a 3x3 board.\n";
+        cout << "Options:\n";
+        cout << "  --checkpoint FILE             Save the search progress to FILE periodically\n";
+        cout << "  --checkpoint-interval SECONDS Time between two checkpoints (default: 60)\n";
+        cout << "  --resume                      Continue the search saved in the checkpoint FILE\n";
+        cout << "  --timeout SECONDS             Stop the search after the given time\n";
+        cout << "  --max-nodes N                 Stop the search after trying N stone placements\n";
+        cout << "  --shard I/N                   Search only the I-th of N disjoint parts of the search space\n";
+        cout << "  --shard-depth K               Split the search by the first K placements (default: 2)\n";
+        cout << "  --shard-result FILE           Write the shard's result to FILE (default: shard-I-of-N.txt)\n";
+        cout << "  --shard-solutions             Include the solutions in the shard's result\n";
+        cout << "  --output FILE                 Write all solutions to FILE, - for standard output\n";
+        cout << "  --format FORMAT               Format of the solutions written: text (default), jsonl or binary\n";
+        cout << "  --trie                        Search all layouts at once, sharing their common placements\n";
+        cout << "  --latin                       Cross-check: Count boards by cutting the stones out of all Latin squares, slow (up to 5x5)\n";
+        cout << "  --first                       Stop at the first solution, searching in random orders with restarts\n";
+        cout << "  --seed N                      Seed of the random orders of --first (default: 0)\n";
+        cout << "  --exists                      Only tell whether a solution exists, like --first\n";
+        cout << "  --threads N                   Search in N threads with --first or --exists, stopping all at the first solution\n";
+        cout << "  --trace FILE                  Record where the time goes and save it as Chrome trace events to FILE\n";
+        cout << "  --progress SECONDS            Report progress and the estimated time left to stderr periodically\n";
+        cout << "  --status FILE                 Write the progress to FILE instead (default interval: 10 seconds)\n";
+        cout << "  --cache FILE                  Look up and keep the solutions of puzzles searched before in FILE\n";
+        cout << "  --mem-stats                   Print allocations per phase when done (needs FIVE_COLORS_ALLOCATION_TRACKING)" << endl;
         return 0;
     }
 
-    size_t solution_count = 0;
-    for (auto const &layout : LayoutGenerator::findAll(stones)) {
-        auto const solutions = Solver(layout, stones).findAssignment();
-        solution_count += solutions.size();
+    for (auto const &value : checkpoint.stones) {
+        if (!Palette::contains(value)) {
+            cerr << "Stone " << value << " contains characters other than the supported colors " << Palette::symbols() << "." << endl;
+            return 1;
+        }
+        if (value.size() > Stone::maxSize) {
+            cerr << "Stone " << value << " is longer than the maximum of " << Stone::maxSize << " colors." << endl;
+            return 1;
+        }
+        stones << value;
+    }
+    string reason;
+    if (!Solver::isFeasible(stones, reason)) {
+        cerr << reason << endl;
+        cout << "Found 0 solution(s) in total." << endl;
+        return 0;
+    }
+
+    bool const sharded = options.shard.count > 1 || !shard_file.empty();
+    if (sharded && shard_file.empty()) {
+        shard_file = "shard-" + to_string(options.shard.index) + "-of-" + to_string(options.shard.count) + ".txt";
+    }
+    bool const limited = max_nodes != numeric_limits<uint64_t>::max() || options.deadline != Time::time_point::max();
+    if (trie && (sharded || limited || !checkpoint_file.empty())) {
+        cerr << "The --trie search does not support checkpoints, shards or limits." << endl;
+        return 1;
+    }
+    if (latin && (sharded || limited || trie || first || !checkpoint_file.empty() || !cache_file.empty())) {
+        cerr << "The --latin search does not support checkpoints, shards, limits, caches, --trie or --first." << endl;
+        return 1;
+    }
+    if (first && (sharded || trie || !checkpoint_file.empty())) {
+        cerr << "The --first and --exists searches do not support checkpoints, shards or --trie." << endl;
+        return 1;
+    }
+    if (!cache_file.empty() && (first || trie || sharded || limited || !checkpoint_file.empty())) {
+        cerr << "The --cache option does not support checkpoints, shards, limits, --first or --trie." << endl;
+        return 1;
+    }
+    if (resume && shard_solutions) {
+        cerr << "Cannot resume: The solutions found before the checkpoint are not part of it." << endl;
+        return 1;
+    }
+
+    if (resume) {
+        auto const stone_values = checkpoint.stones;
+        if (checkpoint_file.empty() || !checkpoint.load(checkpoint_file)) {
+            cerr << "Cannot resume: Unable to read checkpoint file '" << checkpoint_file << "'." << endl;
+            return 1;
+        }
+        if (checkpoint.stones != stone_values) {
+            cerr << "Cannot resume: The checkpoint was saved for different stones." << endl;
+            return 1;
+        }
+        if (checkpoint.shard.index != options.shard.index || checkpoint.shard.count != options.shard.count ||
+            checkpoint.shard.depth != options.shard.depth || checkpoint.maxNodes != max_nodes) {
+            cerr << "Cannot resume: The checkpoint was saved with a different --shard, --shard-depth or --max-nodes." << endl;
+            return 1;
+        }
+    }
+    checkpoint.shard = options.shard;
+    checkpoint.maxNodes = max_nodes;
+
+    ofstream output_stream;
+    unique_ptr<SolutionWriter> writer;
+    // Bytes in the output file before this run
+    uint64_t const output_base = resume && output_file != "-" ? checkpoint.output : 0;
+    if (!output_file.empty()) {
+        if (output_base > 0) {
+            // Solutions written after the checkpoint are found again, so they are cut off
+            struct stat status;
+            if (stat(output_file.c_str(), &status) != 0 || uint64_t(status.st_size) < output_base ||
+                truncate(output_file.c_str(), off_t(output_base)) != 0) {
+                cerr << "Cannot resume: The output file '" << output_file << "' is missing or shorter than at the checkpoint." << endl;
+                return 1;
+            }
+        }
+        if (output_file != "-") {
+            auto const mode = output_base > 0 ? ios::binary | ios::app : ios::binary | ios::trunc;
+            output_stream.open(output_file, mode);
+            if (!output_stream) {
+                cerr << "Unable to open output file '" << output_file << "'." << endl;
+                return 1;
+            }
+        }
+        writer.reset(new SolutionWriter(output_file == "-" ? cout : output_stream, format));
+        if (output_base > 0) {
+            vector<size_t> sizes;
+            LayoutGenerator::sizes(stones, sizes);
+            writer->resume(sizes.size() - 1);
+        }
+    }
+
+    unique_ptr<ResultCache> cache;
+    unique_ptr<CanonicalStones> puzzle;
+    Solutions found;
+    if (!cache_file.empty()) {
+        // Puzzles with renamed colors or reordered stones share their solutions
+        cache.reset(new ResultCache(cache_file));
+        if (!cache->error().empty()) {
+            cerr << cache->error() << " Ignoring it." << endl;
+        }
+        puzzle.reset(new CanonicalStones(stones));
+        size_t count = 0;
+        // The solutions are translated only if they are written
+        if (cache->find(*puzzle, count, found, writer ? numeric_limits<size_t>::max() : 0)) {
+            vector<size_t> sizes;
+            LayoutGenerator::sizes(stones, sizes);
+            if (writer) {
+                for (auto const &solution : found) {
+                    writer->write(sizes.size() - 1, solution);
+                }
+                writer->flush();
+            }
+            cout << "Found " << count << " solution(s) in total." << endl;
+            return 0;
+        }
+    }
+
+    if (latin) {
+        LatinSolver const solver(stones);
+        if (!solver.error().empty()) {
+            cerr << "The --latin search cannot be used: " << solver.error() << endl;
+            return 1;
+        }
+        vector<size_t> sizes;
+        LayoutGenerator::sizes(stones, sizes);
+        auto const boards = solver.findBoards([&writer, &sizes](const Solution &solution) {
+            if (writer) {
+                writer->write(sizes.size() - 1, solution);
+            }
+        });
+        if (writer) {
+            writer->flush();
+        }
+        cout << "Found " << boards << " board(s) in total, rotated and mirrored ones included." << endl;
+        return 0;
+    }
+
+    LayoutFilter filter(stones);
+    if (first) {
+        Layouts layouts;
+        for (auto const &layout : LayoutGenerator::findAll(stones)) {
+            if (filter.accepts(layout)) {
+                layouts.push_back(layout);
+            }
+        }
+        options.maxNodes = max_nodes;
+        Portfolio portfolio(layouts, stones);
+        portfolio.setSeed(seed);
+        auto const result = threads > 1 ? portfolio.find(threads, options) : FirstSolver(layouts, stones, seed).find(options);
+        if (result.found && exists) {
+            cout << "A solution exists." << endl;
+            return 0;
+        }
+        if (result.found) {
+            Solver::printSolution(result.solution);
+            Board(layouts.front().boardSize(), result.solution).print();
+            if (writer) {
+                writer->write(layouts.front().boardSize(), result.solution);
+                writer->flush();
+            }
+            cout << "Found a solution after " << result.nodes << " placements and " << result.restarts << " restart(s)." << endl;
+            return 0;
+        }
+        if (!result.complete) {
+            cout << "Search stopped early after " << result.nodes << " placements without finding a solution." << endl;
+            return 2;
+        }
+        cout << (exists ? "No solution exists." : "Found 0 solution(s) in total.") << endl;
+        return 0;
+    }
+    if (trie) {
+        Layouts layouts;
+        for (auto const &layout : LayoutGenerator::findAll(stones)) {
+            if (filter.accepts(layout)) {
+                layouts.push_back(layout);
+            }
+        }
+        size_t const size = layouts.empty() ? 0 : layouts.front().boardSize();
+        auto const solutions = LayoutTrie(layouts, stones).findAssignment([&writer, size](size_t, const Solution &solution) {
+            if (writer) {
+                writer->write(size, solution);
+            }
+        });
+        if (writer) {
+            writer->flush();
+        }
+        cout << "Found " << solutions << " solution(s) in total." << endl;
+        return 0;
+    }
+
+    unique_ptr<Progress> progress;
+    if (progress_interval.count() > 0 || !status_file.empty()) {
+        auto const interval = progress_interval.count() > 0 ? progress_interval : std::chrono::seconds(10);
+        progress.reset(new Progress(LayoutGenerator::count(stones).unique, interval, status_file));
+    }
+
+    // Checking the time is not for free, do it only every now and then
+    bool const periodic = !checkpoint_file.empty() || progress;
+    uint64_t const nodes = periodic ? (1 << 20) : numeric_limits<uint64_t>::max();
+    auto last_checkpoint = Time::now();
+    uint64_t used_nodes = 0;
+    bool stopped = false;
+    Solution best;
+    size_t index = 0;
+    // Layouts are searched while they are generated, such that the first solutions appear right away
+    // A resumed search state is checked against its layout before searching on, as the file may be stale
+    bool unchecked = resume;
+    bool invalid = false;
+    LayoutGenerator::forEach(stones, [&](const Layout &layout) {
+        if (unchecked && index == checkpoint.layout) {
+            unchecked = false;
+            if (!SolutionIterator::isValid(layout, stones, checkpoint.state)) {
+                invalid = true;
+                return false;
+            }
+        }
+        if (index < checkpoint.layout) {
+            // Searched before already
+            if (progress) {
+                progress->startLayout();
+            }
+            ++index;
+            return true;
+        }
+        if (!filter.accepts(layout)) {
+            if (progress) {
+                progress->startLayout();
+            }
+            checkpoint.layout = ++index;
+            checkpoint.state = SolutionIterator::State();
+            return true;
+        }
+        options.maxNodes = max_nodes;
+        if (options.nodesLeft(used_nodes) == 0) {
+            // The last layout used up the budget, this one is searched by the next run
+            stopped = true;
+            return false;
+        }
+        options.maxNodes = options.nodesLeft(used_nodes);
+        options.shard.layout = index;
+        TraceSpan span("solve layout");
+        MemoryPhase phase(Memory::Solve);
+        SolutionIterator iterator(layout, stones, checkpoint.state, options);
+        if (progress) {
+            // A few probes are cheap compared to the search itself
+            progress->startLayout(iterator.estimate(10, index));
+        }
+        while (true) {
+            if (progress) {
+                progress->update(used_nodes + iterator.nodes(), checkpoint.solutions);
+            }
+            if (iterator.next(nodes)) {
+                if (iterator.atEnd()) {
+                    break;
+                }
+                ++checkpoint.solutions;
+                if (writer) {
+                    writer->write(layout.boardSize(), iterator.solution());
+                }
+                if (shard_solutions) {
+                    shard_result.boards.push_back(Board(layout.boardSize(), iterator.solution()).signature());
+                }
+                if (cache && found.size() <= ResultCache::maxSolutions) {
+                    // One more than kept marks the puzzle as too large to keep
+                    found.push_back(iterator.solution());
+                }
+            }
+            if (!checkpoint_file.empty() && Time::now() - last_checkpoint >= interval) {
+                if (writer) {
+                    // Solutions before the checkpoint must not get lost when resuming
+                    writer->flush();
+                    checkpoint.output = output_stream.is_open() ? output_base + writer->bytes() : 0;
+                }
+                checkpoint.state = iterator.state();
+                if (!checkpoint.save(checkpoint_file)) {
+                    cerr << "Failed to write checkpoint file '" << checkpoint_file << "'." << endl;
+                }
+                last_checkpoint = Time::now();
+            }
+        }
+        used_nodes += iterator.nodes();
+        auto const deepest = iterator.best();
+        if (deepest.size() > best.size()) {
+            best = deepest;
+        }
+        if (iterator.stopped()) {
+            // Keep the state, such that the search can be resumed. Only --timeout may differ then, --max-nodes must not.
+            checkpoint.state = iterator.state();
+            stopped = true;
+            return false;
+        }
+        checkpoint.layout = ++index;
+        checkpoint.state = SolutionIterator::State();
+        return true;
+    });
+    // A finished search is saved with the layout index past the last one
+    if (invalid || index < checkpoint.layout || (unchecked && !checkpoint.state.path.empty())) {
+        // Keep the checkpoint file as it is
+        cerr << "Cannot resume: The search state in checkpoint file '" << checkpoint_file << "' does not fit the stones." << endl;
+        return 1;
+    }
+    if (progress) {
+        progress->finish();
+    }
+    if (writer) {
+        writer->flush();
+        checkpoint.output = output_stream.is_open() ? output_base + writer->bytes() : 0;
+    }
+    if (!checkpoint_file.empty() && !checkpoint.save(checkpoint_file)) {
+        cerr << "Failed to write checkpoint file '" << checkpoint_file << "'." << endl;
+    }
+    if (cache && !stopped) {
+        cache->insert(*puzzle, found);
+        if (!cache->save()) {
+            cerr << "Failed to write cache file '" << cache_file << "'." << endl;
+        }
+    }
+    if (sharded) {
+        shard_result.stones = checkpoint.stones;
+        shard_result.shard = options.shard;
+        shard_result.solutions = checkpoint.solutions;
+        shard_result.complete = !stopped;
+        if (!shard_result.save(shard_file)) {
+            cerr << "Failed to write shard result file '" << shard_file << "'." << endl;
+            return 1;
+        }
+    }
+    if (stopped) {
+        cout << "Search stopped early after " << used_nodes << " placements. Most stones placed:" << endl;
+        Solver::printSolution(best);
+        cout << "Found " << checkpoint.solutions << " solution(s) so far." << endl;
+        return 2;
+    }
+    if (sharded) {
+        cout << "Found " << checkpoint.solutions << " solution(s) in shard " << options.shard.index << "/" << options.shard.count << "." << endl;
+        return 0;
     }
-    cout << "Found " << solution_count << " solution(s) in total." << endl;
+    cout << "Found " << checkpoint.solutions << " solution(s) in total." << endl;
 }
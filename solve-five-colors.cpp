@@ -26,6 +26,7 @@
 // ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
 // POSSIBILITY OF SUCH DAMAGE.
 
+#include "builtin.h"
 #include "puzzle.h"
 
 #include <chrono>
@@ -33,27 +34,33 @@
 
 using namespace std;
 
+using FiveColorsSolver = BuiltinSolver<5, 9>;
+constexpr FiveColorsSolver puzzle({"DRB", "RDG", "GYR", "YBD", "BGY", "BGD", "RDY", "YR", "GB"});
+
+// The answer of puzzle.solve(). Searching it while compiling needs about 100 million constexpr operations,
+// beyond the default limits of compilers, so the unit tests search it at runtime instead and compare.
+constexpr FiveColorsSolver::Result answer = {1,
+                                             {{0, 0, 0, false, true},
+                                              {2, 0, 1, false, false},
+                                              {6, 0, 2, true, true},
+                                              {5, 1, 2, true, false},
+                                              {8, 2, 2, true, false},
+                                              {4, 2, 4, false, true},
+                                              {3, 3, 0, true, false},
+                                              {7, 3, 3, false, true},
+                                              {1, 4, 0, true, true}},
+                                             "BGYDRRYBGDDRGBYYBDRGGDRYB"};
+static_assert(puzzle.verify(answer), "The built-in answer does not solve the five-colors puzzle");
+
 class FiveColors
 {
 public:
     FiveColors()
     {
-        Stones stones;
-        stones << "DRB" << "RDG" << "GYR" << "YBD" << "BGY" << "BGD" << "RDY";
-        stones << "YR" << "GB";
-
-        size_t solution_count = 0;
-        for (auto const &layout : LayoutGenerator::findAll(stones)) {
-            auto const solutions = Solver(layout, stones).findAssignment();
-            for (auto const &solution: solutions) {
-                Solver::printSolution(solution);
-                Board board(layout.boardSize(), solution);
-                board.print();
-            }
-
-            solution_count += solutions.size();
-        }
-        cout << "Found " << solution_count << " solution(s) in total." << endl;
+        auto const solution = puzzle.solution(answer);
+        Solver::printSolution(solution);
+        Board(5, solution).print();
+        cout << "Found " << answer.count << " solution(s) in total, counting rotated and mirrored boards once." << endl;
     }
 };
 
@@ -0,0 +1,90 @@
+// Copyright 2018 Dennis Nienhüser
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "statefile.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+using namespace std;
+
+bool StateFile::save(const string &filename, const string &magic, int version, const vector<string> &stones,
+                     const Shard &shard, const Writer &write)
+{
+    string const temporary = filename + ".tmp";
+    {
+        ofstream file(temporary);
+        if (!file) {
+            return false;
+        }
+        file << magic << ' ' << version << '\n';
+        file << "stones";
+        for (auto const &stone : stones) {
+            file << ' ' << stone;
+        }
+        file << '\n';
+        file << "shard " << shard.index << ' ' << shard.count << ' ' << shard.depth << '\n';
+        write(file);
+        file.flush();
+        if (!file) {
+            return false;
+        }
+    }
+    return rename(temporary.c_str(), filename.c_str()) == 0;
+}
+
+bool StateFile::load(istream &file, const string &magic, int version, vector<string> &stones, Shard &shard)
+{
+    string line;
+    string key;
+    int fileVersion = 0;
+    if (!(file >> key >> fileVersion) || key != magic || fileVersion != version) {
+        return false;
+    }
+    getline(file, line);
+
+    if (!getline(file, line)) {
+        return false;
+    }
+    istringstream stoneLine(line);
+    stoneLine >> key;
+    if (key != "stones") {
+        return false;
+    }
+    stones.clear();
+    for (string stone; stoneLine >> stone; ) {
+        if (stone.size() > Stone::maxSize || !Palette::contains(stone)) {
+            return false;
+        }
+        stones.push_back(stone);
+    }
+
+    return (file >> key >> shard.index >> shard.count >> shard.depth) && key == "shard" &&
+           shard.index < shard.count;
+}
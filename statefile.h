@@ -0,0 +1,56 @@
+// Copyright 2018 Dennis Nienhüser
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef STATEFILE_H
+#define STATEFILE_H
+
+#include "puzzle.h"
+
+#include <functional>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+// The parts that checkpoints and shard results share. Both are text files starting with a magic word and a
+// version, followed by the stones and the shard searched, one field per line.
+class StateFile
+{
+public:
+    using Writer = std::function<void(std::ostream & file)>;
+
+    // Writes the common parts and then the ones of the caller to a temporary file, which replaces the file
+    // at the end, such that an interruption never leaves a broken file
+    static bool save(const std::string & filename, const std::string & magic, int version,
+                     const std::vector<std::string> & stones, const Shard & shard, const Writer & write);
+    // Reads the common parts, leaving the file at the ones of the caller. Fails for other formats, stones
+    // that cannot exist and shard indices out of range.
+    static bool load(std::istream & file, const std::string & magic, int version,
+                     std::vector<std::string> & stones, Shard & shard);
+};
+
+#endif
@@ -0,0 +1,144 @@
+// Copyright 2018 Dennis Nienhüser
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "trace.h"
+
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using namespace std;
+
+atomic<bool> Trace::enabled_(false);
+
+struct Span {
+    char const *name;
+    Trace::Time::time_point begin;
+    Trace::Time::time_point end;
+};
+
+// The spans of one thread. Once full, new spans replace the oldest ones.
+struct Buffer {
+    vector<Span> spans;
+    size_t next = 0;
+    bool wrapped = false;
+    size_t thread = 0;
+};
+
+struct Registry {
+    mutex lock;
+    vector<unique_ptr<Buffer>> buffers;
+    size_t capacity = 0;
+    Trace::Time::time_point start;
+};
+
+static Registry &registry()
+{
+    static Registry instance;
+    return instance;
+}
+
+static Buffer &buffer()
+{
+    // Owned by the registry, such that the spans survive the thread
+    thread_local Buffer *local = nullptr;
+    if (!local) {
+        auto &all = registry();
+        lock_guard<mutex> guard(all.lock);
+        all.buffers.emplace_back(new Buffer());
+        local = all.buffers.back().get();
+        local->spans.resize(all.capacity);
+        local->thread = all.buffers.size();
+    }
+    return *local;
+}
+
+static void appendEscaped(string &output, const char *value)
+{
+    for (; *value; ++value) {
+        if (*value == '"' || *value == '\\') {
+            output += '\\';
+        }
+        output += *value;
+    }
+}
+
+void Trace::enable(size_t capacity)
+{
+    auto &all = registry();
+    {
+        lock_guard<mutex> guard(all.lock);
+        all.capacity = max(size_t(1), capacity);
+        all.start = Time::now();
+    }
+    enabled_.store(true, memory_order_relaxed);
+}
+
+void Trace::record(const char *name, Time::time_point begin, Time::time_point end)
+{
+    auto &local = buffer();
+    if (local.spans.empty()) {
+        return;
+    }
+    local.spans[local.next] = {name, begin, end};
+    if (++local.next == local.spans.size()) {
+        local.next = 0;
+        local.wrapped = true;
+    }
+}
+
+bool Trace::save(const string &file)
+{
+    auto &all = registry();
+    lock_guard<mutex> guard(all.lock);
+    string output = "{\"traceEvents\":[\n";
+    bool first = true;
+    for (auto const &local : all.buffers) {
+        // Oldest spans first
+        size_t const count = local->wrapped ? local->spans.size() : local->next;
+        size_t const offset = local->wrapped ? local->next : 0;
+        for (size_t i = 0; i < count; ++i) {
+            auto const &span = local->spans[(offset + i) % local->spans.size()];
+            using Microseconds = chrono::duration<double, micro>;
+            auto const begin = chrono::duration_cast<Microseconds>(span.begin - all.start).count();
+            auto const duration = chrono::duration_cast<Microseconds>(span.end - span.begin).count();
+            output += first ? "" : ",\n";
+            output += "{\"name\":\"";
+            appendEscaped(output, span.name);
+            output += "\",\"ph\":\"X\",\"pid\":1,\"tid\":" + to_string(local->thread);
+            output += ",\"ts\":" + to_string(begin) + ",\"dur\":" + to_string(duration) + "}";
+            first = false;
+        }
+    }
+    output += "\n]}\n";
+
+    ofstream stream(file, ios::binary | ios::trunc);
+    stream << output;
+    return bool(stream);
+}
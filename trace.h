@@ -0,0 +1,84 @@
+// Copyright 2018 Dennis Nienhüser
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Opt-in recording of timed spans. Each thread records into its own ring buffer, which keeps the most
+// recent spans only. The spans are saved as Chrome trace events, e.g. for chrome://tracing or Perfetto.
+class Trace
+{
+public:
+    using Time = std::chrono::steady_clock;
+
+    // Starts recording, keeping at most the given number of spans per thread
+    static void enable(size_t capacity = 1 << 16);
+    static bool enabled()
+    {
+        return enabled_.load(std::memory_order_relaxed);
+    }
+    static void record(const char *name, Time::time_point begin, Time::time_point end);
+    // Writes the spans of all threads. Threads should not record spans meanwhile.
+    static bool save(const std::string &file);
+
+private:
+    static std::atomic<bool> enabled_;
+};
+
+// Records a span covering its own lifetime. The name must outlive the trace, e.g. be a string literal.
+class TraceSpan
+{
+public:
+    explicit TraceSpan(const char *name) : name_(Trace::enabled() ? name : nullptr)
+    {
+        if (name_) {
+            begin_ = Trace::Time::now();
+        }
+    }
+
+    ~TraceSpan()
+    {
+        if (name_) {
+            Trace::record(name_, begin_, Trace::Time::now());
+        }
+    }
+
+    TraceSpan(const TraceSpan &) = delete;
+    TraceSpan &operator=(const TraceSpan &) = delete;
+
+private:
+    char const *name_;
+    Trace::Time::time_point begin_;
+};
+
+#endif
@@ -29,13 +29,55 @@
 #include <iostream>
 #include <cassert>
 
+#include "builtin.h"
+#include "cache.h"
+#include "counters.h"
+#include "latin.h"
+#include "memory.h"
+#include "portfolio.h"
+#include "progress.h"
 #include "puzzle.h"
+#include "shard.h"
+#include "trace.h"
+#include "writer.h"
+
+#include <fstream>
+#include <set>
+#include <sstream>
 
 #define VERIFY(cond) if (!(cond)) {std::cout << "unit test failed at " << __FILE__ << ":" << __LINE__ << std::endl; assert(false); exit(127); }
 #define VERIFY_EQUAL(valA, valB) if (!(valA == valB)) {std::cout << "unit test failed at " << __FILE__ << ":" << __LINE__ << ". Failure: " << valA << " != " << valB << std::endl; assert(false); exit(127); }
 
 using namespace std;
 
+// A 4x4 puzzle many tests solve, and one of its layouts
+static Layout mediumLayout()
+{
+    Layout layout(4);
+    layout.add({3, 0, 1, true, false});
+    layout.add({3, 1, 1, true, false});
+    layout.add({3, 2, 1, true, false});
+    layout.add({3, 0, 0, false, false});
+    layout.add({2, 3, 0, true, false});
+    layout.add({2, 3, 2, true, false});
+    return layout;
+}
+
+static Stones mediumStones()
+{
+    Stones stones;
+    stones << "GBD" << "RGB" << "DRG" << "RDB" << "GB" << "DR";
+    return stones;
+}
+
+// A 5x5 puzzle of five colors, small enough for tests to search completely
+static Stones fiveColorStones()
+{
+    Stones stones;
+    stones << "DR" << "GB" << "BYR" << "YDG" << "RGY" << "BGY" << "DYR" << "DRB" << "GBD";
+    return stones;
+}
+
 class SmallGame
 {
 public:
@@ -71,13 +113,7 @@ class MediumGame
 public:
     MediumGame()
     {
-        Layout layout(4);
-        layout.add({3, 0, 1, true, false});
-        layout.add({3, 1, 1, true, false});
-        layout.add({3, 2, 1, true, false});
-        layout.add({3, 0, 0, false, false});
-        layout.add({2, 3, 0, true, false});
-        layout.add({2, 3, 2, true, false});
+        auto const layout = mediumLayout();
         VERIFY(layout.isFull());
 
         Stones stones;
@@ -260,10 +296,1167 @@ public:
     }
 };
 
+class LayoutCounting
+{
+public:
+    LayoutCounting()
+    {
+        // Two horizontal or two vertical stones, which are the same layout when rotated
+        auto const domino = LayoutGenerator::count(vector<size_t>({0, 0, 2}));
+        VERIFY_EQUAL(2, domino.total);
+        VERIFY_EQUAL(1, domino.unique);
+
+        vector<vector<size_t>> const histograms = {{0, 0, 2, 7}, {0, 4, 2, 0, 2}, {0, 1, 0, 5}, {0, 2, 1, 0, 3}};
+        for (auto const &histogram : histograms) {
+            auto const count = LayoutGenerator::count(histogram);
+            VERIFY_EQUAL(LayoutGenerator::findAll(histogram).size(), count.unique);
+            VERIFY(count.total >= count.unique);
+        }
+
+        Stones stones;
+        stones << "DRB" << "RDG" << "GYR" << "YBD" << "BGY" << "BGD" << "RDY" << "YR" << "GB";
+        VERIFY_EQUAL(164, LayoutGenerator::count(stones).total);
+        VERIFY_EQUAL(24, LayoutGenerator::count(stones).unique);
+    }
+};
+
+// The boards of all solutions of the layout, found by trying each order and direction of the stones. Slow, but
+// independent of the solvers.
+static set<string> tryAll(const Layout &layout, const Stones &stones)
+{
+    auto const byValue = [](const Stone &a, const Stone &b) { return a.value() < b.value(); };
+    vector<Stone> order(stones.begin(), stones.end());
+    sort(order.begin(), order.end(), byValue);
+    auto const &positions = layout.positions();
+    set<string> result;
+    do {
+        for (size_t reversed = 0; reversed < (size_t(1) << order.size()); ++reversed) {
+            Solution solution;
+            for (size_t i = 0; i < order.size() && order[i].fields.size() == positions[i].size; ++i) {
+                auto position = positions[i];
+                position.reverse = (reversed >> i) & 1;
+                solution.push_back({position, order[i]});
+            }
+            if (solution.size() == order.size()) {
+                Board const board(layout.boardSize(), solution);
+                if (board.isValid() && board.isFull()) {
+                    result.insert(board.signature());
+                }
+            }
+        }
+    } while (next_permutation(order.begin(), order.end(), byValue));
+    return result;
+}
+
+class Iteration
+{
+public:
+    Iteration()
+    {
+        auto const layout = mediumLayout();
+        auto const stones = mediumStones();
+        Solver solver(layout, stones);
+        auto const expected = tryAll(layout, stones);
+        VERIFY_EQUAL(16, expected.size());
+
+        size_t count = 0;
+        set<string> found;
+        for (auto iterator = solver.begin(); !iterator.atEnd(); iterator.next()) {
+            Board board(layout.boardSize(), iterator.solution());
+            VERIFY(board.isValid());
+            VERIFY(board.isFull());
+            found.insert(board.signature());
+            ++count;
+        }
+        VERIFY_EQUAL(16, count);
+        VERIFY(found == expected);
+
+        // Stopping early leaves the remaining solutions unexplored
+        auto iterator = solver.begin();
+        VERIFY(!iterator.atEnd());
+        VERIFY_EQUAL(layout.positions().size(), iterator.solution().size());
+    }
+};
+
+class Resumption
+{
+public:
+    Resumption()
+    {
+        auto const layout = mediumLayout();
+        auto const stones = mediumStones();
+        vector<string> expected;
+        for (auto const &solution : Solver(layout, stones).findAssignment()) {
+            expected.push_back(Board(layout.boardSize(), solution).signature());
+        }
+
+        // Interrupt the search after a few solutions and continue it elsewhere
+        vector<string> found;
+        SolutionIterator first(layout, stones);
+        found.push_back(Board(layout.boardSize(), first.solution()).signature());
+        for (int i = 1; i < 5; ++i) {
+            first.next();
+            found.push_back(Board(layout.boardSize(), first.solution()).signature());
+        }
+        VERIFY(SolutionIterator::isValid(layout, stones, first.state()));
+        SolutionIterator second(layout, stones, first.state());
+        for (second.next(); !second.atEnd(); second.next()) {
+            found.push_back(Board(layout.boardSize(), second.solution()).signature());
+        }
+        VERIFY(found == expected);
+
+        // States from stale or edited files are rejected
+        auto state = first.state();
+        VERIFY(!state.path.empty());
+        state.path.back().stone = stones.size();
+        VERIFY(!SolutionIterator::isValid(layout, stones, state));
+        state = first.state();
+        state.path.push_back(state.path.front());
+        VERIFY(!SolutionIterator::isValid(layout, stones, state));
+        state.path.assign(layout.positions().size(), SolutionIterator::Choice());
+        VERIFY(!SolutionIterator::isValid(layout, stones, state));
+        state = first.state();
+        state.cursor.stone = stones.size() + 1;
+        VERIFY(!SolutionIterator::isValid(layout, stones, state));
+        // The first position takes a stone of three colors
+        state = SolutionIterator::State();
+        state.path.push_back({4, false});
+        VERIFY(!SolutionIterator::isValid(layout, stones, state));
+
+        // A tiny budget suspends the search often, but does not change its outcome
+        found.clear();
+        SolutionIterator third(layout, stones, SolutionIterator::State());
+        size_t suspended = 0;
+        while (true) {
+            if (!third.next(1)) {
+                ++suspended;
+                continue;
+            }
+            if (third.atEnd()) {
+                break;
+            }
+            found.push_back(Board(layout.boardSize(), third.solution()).signature());
+        }
+        VERIFY(found == expected);
+        VERIFY(suspended > 0);
+        VERIFY(third.nodes() > 0);
+    }
+};
+
+class Budgets
+{
+public:
+    Budgets()
+    {
+        auto const layout = mediumLayout();
+        auto const stones = mediumStones();
+        Solver solver(layout, stones);
+
+        auto const all = solver.findAssignment(SolveOptions());
+        VERIFY(all.complete);
+        VERIFY_EQUAL(16, all.solutions.size());
+        VERIFY_EQUAL(layout.positions().size(), all.best.size());
+
+        SolveOptions options;
+        options.maxNodes = 10;
+        auto const limited = solver.findAssignment(options);
+        VERIFY(!limited.complete);
+        VERIFY(limited.nodes < all.nodes);
+        VERIFY(!limited.best.empty());
+        VERIFY(Board(layout.boardSize(), limited.best).isValid());
+
+        options = SolveOptions();
+        options.deadline = SolveOptions::Time::now();
+        VERIFY(!solver.findAssignment(options).complete);
+
+        atomic<bool> cancel(true);
+        options = SolveOptions();
+        options.cancel = &cancel;
+        auto const cancelled = solver.findAssignment(options);
+        VERIFY(!cancelled.complete);
+        VERIFY_EQUAL(0, cancelled.nodes);
+
+        // A layout may finish a few placements past the budget, leaving nothing for the next one
+        options = SolveOptions();
+        options.maxNodes = 10;
+        VERIFY_EQUAL(3, options.nodesLeft(7));
+        VERIFY_EQUAL(0, options.nodesLeft(10));
+        VERIFY_EQUAL(0, options.nodesLeft(12));
+
+        // The hint searching the most layouts before it finds a solution
+        Solution placed;
+        Hint hint;
+        for (size_t cell = 0; cell < 16; ++cell) {
+            Solution candidate;
+            candidate.push_back({{3, cell / 4, cell % 4, true, false}, Stone("GBD")});
+            auto const found = PartialSolver(stones, candidate).find();
+            if (found.feasible && found.nodes > hint.nodes) {
+                placed = candidate;
+                hint = found;
+            }
+        }
+        VERIFY(hint.feasible);
+        PartialSolver const partial(stones, placed);
+        size_t overshoots = 0;
+        for (uint64_t budget = 1; budget < hint.nodes; ++budget) {
+            options.maxNodes = budget;
+            auto const limited_hint = partial.find(options);
+            VERIFY(!limited_hint.complete);
+            // A single step tries each stone in both directions at most
+            VERIFY(limited_hint.nodes < budget + 2 * stones.size());
+            overshoots += limited_hint.nodes > budget ? 1 : 0;
+        }
+        VERIFY(overshoots > 0);
+    }
+};
+
+class Colors
+{
+public:
+    Colors()
+    {
+        VERIFY_EQUAL(Palette::maxColors, Palette::symbols().size());
+        string const common = "BDGYR";
+        for (size_t i = 0; i < common.size(); ++i) {
+            VERIFY_EQUAL(i, Palette::id(common[i]));
+        }
+        VERIFY_EQUAL(string("blue"), Palette::name('B'));
+        VERIFY(Palette::contains("BDGYRa0"));
+        VERIFY(!Palette::contains("B G"));
+
+        Board board(3);
+        Stone stone("RGB");
+        Position const first = {3, 0, 0, true, false};
+        Position const second = {3, 1, 0, true, false};
+        VERIFY(board.fits(first, stone));
+        board.assign(first, stone);
+        VERIFY(!board.fits(second, stone));
+        board.assign(second, stone);
+        VERIFY(!board.isValid());
+        board.unassign(second, stone);
+        VERIFY(board.isValid());
+        VERIFY(board.fits({3, 1, 0, true, true}, Stone("RBG")));
+        VERIFY(!board.fits({3, 1, 0, true, false}, Stone("GGR")));
+
+        // Boards larger than the common colors, shuffled without breaking validity
+        size_t const size = Palette::maxColors;
+        Board large(size);
+        for (size_t row = 0; row < size; ++row) {
+            for (size_t col = 0; col < size; ++col) {
+                large.assign(row, col, Palette::symbols()[(row + col) % size]);
+            }
+        }
+        VERIFY(large.isValid());
+        VERIFY(large.isFull());
+        large.swapRows(0, 17);
+        large.swapCols(3, 63);
+        VERIFY(large.isValid());
+        large.assign(5, 5, ' ');
+        large.assign(5, 5, large.at(5, 6));
+        VERIFY(!large.isValid());
+    }
+};
+
+class Sharding
+{
+public:
+    Sharding()
+    {
+        auto const stones = fiveColorStones();
+        auto const layouts = LayoutGenerator::findAll(stones);
+        size_t expected = 0;
+        for (auto const &layout : layouts) {
+            expected += Solver(layout, stones).findAssignment().size();
+        }
+        VERIFY_EQUAL(48, expected);
+
+        for (size_t depth = 1; depth < 4; ++depth) {
+            vector<ShardResult> results(3);
+            for (size_t shard = 0; shard < results.size(); ++shard) {
+                SolveOptions options;
+                options.shard.index = shard;
+                options.shard.count = results.size();
+                options.shard.depth = depth;
+                results[shard].shard = options.shard;
+                for (auto const &layout : layouts) {
+                    results[shard].solutions += Solver(layout, stones).findAssignment(options).solutions.size();
+                    ++options.shard.layout;
+                }
+            }
+
+            ShardResult merged;
+            string error;
+            VERIFY(ShardResult::merge(results, merged, error));
+            VERIFY_EQUAL(expected, merged.solutions);
+            results.pop_back();
+            VERIFY(!ShardResult::merge(results, merged, error));
+            results.push_back(results.front());
+            VERIFY(!ShardResult::merge(results, merged, error));
+        }
+
+        // Shards read from damaged files are checked before their numbers are used
+        ShardResult damaged;
+        damaged.shard.count = numeric_limits<size_t>::max();
+        ShardResult merged;
+        string error;
+        VERIFY(!ShardResult::merge({damaged}, merged, error));
+        string const file = "test-five-colors-shard.txt";
+        damaged.shard.index = 3;
+        damaged.shard.count = 3;
+        VERIFY(damaged.save(file));
+        ShardResult loaded;
+        VERIFY(!loaded.load(file));
+        damaged.shard.index = 2;
+        damaged.boards.push_back("RGB");
+        VERIFY(damaged.save(file));
+        VERIFY(loaded.load(file));
+        remove(file.c_str());
+        VERIFY_EQUAL(2, loaded.shard.index);
+        VERIFY(loaded.boards == damaged.boards);
+    }
+};
+
+class Feasibility
+{
+public:
+    Feasibility()
+    {
+        auto const feasible = [](const vector<string> &values) {
+            Stones stones;
+            for (auto const &value : values) {
+                stones << value;
+            }
+            string reason;
+            bool const result = Solver::isFeasible(stones, reason);
+            VERIFY(result == reason.empty());
+            return result;
+        };
+
+        VERIFY(feasible({"DRB", "RDG", "GYR", "YBD", "BGY", "BGD", "RDY", "YR", "GB"}));
+        // Not square
+        VERIFY(!feasible({"DRB", "RDG", "GYR", "YBD", "BGY", "BGD", "RDY", "YR"}));
+        // Red twice in one stone
+        VERIFY(!feasible({"DRR", "BDG", "GYR", "YBD", "BGY", "BGD", "RDY", "YR", "GB"}));
+        // Blue six times, green four times
+        VERIFY(!feasible({"DRB", "RDB", "GYR", "YBD", "BGY", "BGD", "RDY", "YR", "GB"}));
+        // Three colors on a board with four rows
+        VERIFY(!feasible({"RGB", "GBR", "BRG", "RGB", "RGB", "R"}));
+
+        // Pruning rows and columns that cannot get their missing colors keeps all solutions
+        auto const stones = fiveColorStones();
+        size_t count = 0;
+        for (auto const &layout : LayoutGenerator::findAll(stones)) {
+            count += Solver(layout, stones).findAssignment().size();
+        }
+        VERIFY_EQUAL(48, count);
+    }
+};
+
+class Output
+{
+public:
+    Output()
+    {
+        auto const layout = mediumLayout();
+        auto const stones = mediumStones();
+        auto const solutions = Solver(layout, stones).findAssignment();
+
+        ostringstream text;
+        ostringstream jsonl;
+        ostringstream binary;
+        {
+            // A tiny buffer forces intermediate writes
+            SolutionWriter textWriter(text, SolutionWriter::Format::Text, 20);
+            SolutionWriter jsonlWriter(jsonl, SolutionWriter::Format::Jsonl);
+            SolutionWriter binaryWriter(binary, SolutionWriter::Format::Binary);
+            for (auto const &solution : solutions) {
+                textWriter.write(layout.boardSize(), solution);
+                jsonlWriter.write(layout.boardSize(), solution);
+                binaryWriter.write(layout.boardSize(), solution);
+            }
+            VERIFY_EQUAL(solutions.size(), textWriter.count());
+        }
+
+        string expected;
+        for (auto const &solution : solutions) {
+            expected += Board(layout.boardSize(), solution).signature() + "\n";
+        }
+        VERIFY_EQUAL(expected, text.str());
+
+        istringstream lines(jsonl.str());
+        size_t count = 0;
+        for (string line; getline(lines, line); ++count) {
+            VERIFY_EQUAL(0, line.find("{\"board\":\""));
+            VERIFY_EQUAL('}', line.back());
+        }
+        VERIFY_EQUAL(solutions.size(), count);
+
+        auto const records = binary.str();
+        VERIFY_EQUAL(8 + 16 * solutions.size(), records.size());
+        VERIFY_EQUAL(string("5CS1"), records.substr(0, 4));
+        VERIFY_EQUAL(4, records[4]);
+        auto const board = Board(layout.boardSize(), solutions.front()).signature();
+        for (size_t i = 0; i < board.size(); ++i) {
+            VERIFY_EQUAL(Palette::id(board[i]), ColorId(records[8 + i]));
+        }
+
+        // Continuing the binary output of an earlier run does not repeat the header
+        ostringstream resumed;
+        uint64_t bytes = 0;
+        {
+            SolutionWriter before(resumed, SolutionWriter::Format::Binary);
+            before.write(layout.boardSize(), solutions.front());
+            before.flush();
+            bytes = before.bytes();
+        }
+        VERIFY_EQUAL(resumed.str().size(), bytes);
+        {
+            SolutionWriter after(resumed, SolutionWriter::Format::Binary);
+            after.resume(layout.boardSize());
+            for (auto solution = next(solutions.begin()); solution != solutions.end(); ++solution) {
+                after.write(layout.boardSize(), *solution);
+            }
+        }
+        VERIFY_EQUAL(records, resumed.str());
+    }
+};
+
+class Storage
+{
+public:
+    Storage()
+    {
+        auto const stones = fiveColorStones();
+        size_t count = 0;
+        for (auto const &layout : LayoutGenerator::findAll(stones)) {
+            Solver solver(layout, stones);
+            auto const solutions = solver.findAssignment();
+            auto const store = solver.findAll();
+            VERIFY_EQUAL(solutions.size(), store.size());
+            VERIFY_EQUAL(store.size() * layout.positions().size(), store.bytes());
+            size_t index = 0;
+            for (auto const &solution : solutions) {
+                VERIFY(solution == store.solution(index));
+                VERIFY_EQUAL(Board(layout.boardSize(), solution).signature(), store.board(index).signature());
+                ++index;
+            }
+            count += store.size();
+        }
+        VERIFY_EQUAL(48, count);
+    }
+};
+
+class Filtering
+{
+public:
+    Filtering()
+    {
+        {
+            // The middle column would be green only
+            Stones stones;
+            stones << "RGB" << "RGB" << "BGR";
+            auto const layouts = LayoutGenerator::findAll(stones);
+            VERIFY_EQUAL(1, layouts.size());
+            LayoutFilter filter(stones);
+            VERIFY(!filter.accepts(layouts.front()));
+            VERIFY(Solver(layouts.front(), stones).findAssignment().empty());
+        }
+
+        {
+            Stones stones;
+            stones << "DR" << "GB" << "BYR" << "YRD" << "DGR" << "GYB" << "BGY" << "DYR" << "GBD";
+            LayoutFilter filter(stones);
+            size_t count = 0;
+            for (auto const &layout : LayoutGenerator::findAll(stones)) {
+                auto const solutions = Solver(layout, stones).findAssignment().size();
+                if (!filter.accepts(layout)) {
+                    VERIFY_EQUAL(0, solutions);
+                }
+                count += solutions;
+            }
+            VERIFY_EQUAL(8, count);
+            VERIFY_EQUAL(24, filter.checked());
+            VERIFY_EQUAL(6, filter.rejected());
+        }
+    }
+};
+
+class Trie
+{
+public:
+    Trie()
+    {
+        auto const stones = fiveColorStones();
+        auto const layouts = LayoutGenerator::findAll(stones);
+        vector<set<string>> expected;
+        for (auto const &layout : layouts) {
+            expected.push_back(set<string>());
+            for (auto const &solution : Solver(layout, stones).findAssignment()) {
+                expected.back().insert(Board(layout.boardSize(), solution).signature());
+            }
+        }
+
+        LayoutTrie trie(layouts, stones);
+        VERIFY(trie.size() < layouts.size() * layouts.front().positions().size());
+        vector<set<string>> found(layouts.size());
+        auto const count = trie.findAssignment([&found](size_t layout, const Solution &solution) {
+            found[layout].insert(Board(5, solution).signature());
+        });
+        VERIFY_EQUAL(48, count);
+        VERIFY(expected == found);
+    }
+};
+
+class Tracing
+{
+public:
+    Tracing()
+    {
+        Trace::enable(4);
+        for (int i = 0; i < 6; ++i) {
+            TraceSpan span(i < 2 ? "dropped" : "kept");
+        }
+        Stones stones;
+        stones << "RGB" << "GBR" << "BRG";
+        LayoutGenerator::findAll(stones);
+
+        string const file = "test-five-colors-trace.json";
+        VERIFY(Trace::save(file));
+        ifstream stream(file);
+        string const json((istreambuf_iterator<char>(stream)), istreambuf_iterator<char>());
+        remove(file.c_str());
+        VERIFY_EQUAL(0, json.find("{\"traceEvents\":["));
+        VERIFY_EQUAL(string::npos, json.find("dropped"));
+        VERIFY(json.find("\"name\":\"kept\",\"ph\":\"X\"") != string::npos);
+        VERIFY(json.find("LayoutGenerator::findAll") != string::npos);
+    }
+};
+
+class Restarts
+{
+public:
+    Restarts()
+    {
+        vector<uint64_t> sequence;
+        for (uint64_t i = 1; i <= 15; ++i) {
+            sequence.push_back(FirstSolver::luby(i));
+        }
+        VERIFY(sequence == vector<uint64_t>({1, 1, 2, 1, 1, 2, 4, 1, 1, 2, 1, 1, 2, 4, 8}));
+
+        Stones stones;
+        stones << "DRB" << "RDG" << "GYR" << "YBD" << "BGY" << "BGD" << "RDY" << "YR" << "GB";
+        auto const layouts = LayoutGenerator::findAll(stones);
+        for (uint64_t seed = 0; seed < 4; ++seed) {
+            FirstSolver solver(layouts, stones, seed);
+            solver.setCutoff(16);
+            auto const result = solver.find();
+            VERIFY(result.found);
+            VERIFY(result.complete);
+            VERIFY(result.restarts > 0);
+            Board board(5, result.solution);
+            VERIFY(board.isFull());
+            VERIFY(board.isValid());
+            VERIFY_EQUAL(stones.size(), result.solution.size());
+            for (auto const &assignment : result.solution) {
+                VERIFY(find(stones.begin(), stones.end(), assignment.second) != stones.end());
+            }
+        }
+
+        Stones unsolvable;
+        unsolvable << "RGB" << "RGB" << "BGR";
+        auto const none = FirstSolver(LayoutGenerator::findAll(unsolvable), unsolvable).find();
+        VERIFY(!none.found);
+        VERIFY(none.complete);
+
+        SolveOptions options;
+        options.maxNodes = 10;
+        auto const stopped = FirstSolver(layouts, stones).find(options);
+        VERIFY(!stopped.found);
+        VERIFY(!stopped.complete);
+    }
+};
+
+class Parallel
+{
+public:
+    Parallel()
+    {
+        auto const stones = fiveColorStones();
+        auto const layouts = LayoutGenerator::findAll(stones);
+        Portfolio portfolio(layouts, stones);
+        portfolio.setOrderings(2);
+        auto const result = portfolio.find(4);
+        VERIFY(result.found);
+        VERIFY(result.complete);
+        auto const layout = next(layouts.begin(), long(result.layout));
+        VERIFY_EQUAL(layout->positions().size(), result.solution.size());
+        Board board(5, result.solution);
+        VERIFY(board.isFull());
+        VERIFY(board.isValid());
+
+        Stones unsolvable;
+        unsolvable << "RGB" << "RGB" << "BGR";
+        auto const none = Portfolio(LayoutGenerator::findAll(unsolvable), unsolvable).find(3);
+        VERIFY(!none.found);
+        VERIFY(none.complete);
+
+        atomic<bool> cancel(true);
+        SolveOptions options;
+        options.cancel = &cancel;
+        auto const cancelled = portfolio.find(4, options);
+        VERIFY(!cancelled.found);
+        VERIFY(!cancelled.complete);
+    }
+};
+
+class Streaming
+{
+public:
+    Streaming()
+    {
+        for (auto const &sizes : vector<vector<size_t>>({{0, 0, 2, 7}, {0, 4, 6}, {0, 1, 2, 4, 2}, {0, 0, 3, 6, 3}})) {
+            auto const layouts = LayoutGenerator::findAll(sizes);
+            VERIFY_EQUAL(LayoutGenerator::count(sizes).unique, layouts.size());
+            auto expected = layouts.begin();
+            bool const complete = LayoutGenerator::forEach(sizes, [&](const Layout &layout) {
+                VERIFY(expected != layouts.end());
+                VERIFY(layout == *expected);
+                ++expected;
+                return true;
+            });
+            VERIFY(complete);
+            VERIFY(expected == layouts.end());
+            if (layouts.size() < 1000) {
+                // No two layouts are rotated or mirrored variants of each other
+                VERIFY_EQUAL(layouts.size(), Layout::unify(layouts).size());
+            }
+        }
+
+        size_t count = 0;
+        bool const complete = LayoutGenerator::forEach(vector<size_t>({0, 4, 6}), [&count](const Layout &) {
+            return ++count < 10;
+        });
+        VERIFY(!complete);
+        VERIFY_EQUAL(10, count);
+    }
+};
+
+class Allocations
+{
+public:
+    Allocations()
+    {
+        VERIFY_EQUAL(Memory::Other, Memory::phase());
+        {
+            MemoryPhase solve(Memory::Solve);
+            {
+                MemoryPhase output(Memory::Output);
+                VERIFY_EQUAL(Memory::Output, Memory::phase());
+            }
+            VERIFY_EQUAL(Memory::Solve, Memory::phase());
+        }
+        VERIFY_EQUAL(Memory::Other, Memory::phase());
+        VERIFY_EQUAL(string("layouts"), Memory::name(Memory::Layouts));
+
+        auto const before = Memory::stats(Memory::Output);
+        auto const allocations = Memory::allocations();
+        {
+            MemoryPhase output(Memory::Output);
+            vector<char> buffer(1000);
+        }
+        auto const after = Memory::stats(Memory::Output);
+        if (Memory::tracked()) {
+            VERIFY_EQUAL(allocations + 1, Memory::allocations());
+            VERIFY_EQUAL(before.allocations + 1, after.allocations);
+            VERIFY_EQUAL(before.bytes + 1000, after.bytes);
+            VERIFY(after.peak >= 1000);
+        } else {
+            VERIFY_EQUAL(0, Memory::allocations());
+            VERIFY_EQUAL(0, after.allocations);
+        }
+    }
+};
+
+class Estimation
+{
+public:
+    Estimation()
+    {
+        auto const layout = mediumLayout();
+        auto const stones = mediumStones();
+        auto const all = Solver(layout, stones).findAssignment(SolveOptions());
+
+        SolutionIterator iterator(layout, stones, SolutionIterator::State());
+        auto const estimate = iterator.estimate(1000, 42);
+        VERIFY(estimate > all.nodes / 2.0);
+        VERIFY(estimate < all.nodes * 2.0);
+
+        // Estimating leaves the search where it was
+        size_t count = 0;
+        for (iterator.next(); !iterator.atEnd(); iterator.next()) {
+            ++count;
+        }
+        VERIFY_EQUAL(16, count);
+
+        Progress progress(4, chrono::seconds(60), "");
+        progress.startLayout(estimate);
+        progress.update(all.nodes / 2, 3);
+        auto const status = progress.status();
+        VERIFY_EQUAL(0, status.find("Progress: 0/4 layouts"));
+        VERIFY(status.find("3 solution(s)") != string::npos);
+        VERIFY(status.find("placements left") != string::npos);
+    }
+};
+
+class Switching
+{
+public:
+    Switching()
+    {
+        // Rows 0 and 2 swap colors in columns 0 and 2 only
+        Board board(4);
+        string const colors = "RGBYGRYBBYRGYBGR";
+        for (size_t i = 0; i < colors.size(); ++i) {
+            board.assign(i / 4, i % 4, colors[i]);
+        }
+        VERIFY(board.isValid());
+        auto const signature = board.signature();
+        VERIFY_EQUAL(2, board.switchCycle(0, 2, 0));
+        VERIFY(board.isValid());
+        VERIFY(board.isFull());
+        VERIFY_EQUAL('B', board.at(0, 0));
+        VERIFY_EQUAL('G', board.at(0, 1));
+        VERIFY_EQUAL('R', board.at(0, 2));
+        VERIFY_EQUAL('R', board.at(2, 0));
+        VERIFY(signature != board.signature());
+        VERIFY_EQUAL(2, board.switchCycle(0, 2, 0));
+        VERIFY_EQUAL(signature, board.signature());
+
+        // Cyclic rows of odd length form a single cycle
+        Board odd(3);
+        string const cyclic = "RGBGBRBRG";
+        for (size_t i = 0; i < cyclic.size(); ++i) {
+            odd.assign(i / 3, i % 3, cyclic[i]);
+        }
+        VERIFY_EQUAL(3, odd.switchCycle(1, 2, 1));
+        VERIFY(odd.isValid());
+    }
+};
+
+class Hints
+{
+public:
+    Hints()
+    {
+        auto const stones = mediumStones();
+
+        // All solutions, including rotated and mirrored ones, from solving every layout
+        vector<Solution> solutions;
+        uint64_t nodes = 0;
+        LayoutGenerator::forEach(stones, vector<Position>(), [&](const Layout &layout) {
+            auto const result = Solver(layout, stones).findAssignment(SolveOptions());
+            solutions.insert(solutions.end(), result.solutions.begin(), result.solutions.end());
+            nodes += result.nodes;
+            return true;
+        });
+        VERIFY(!solutions.empty());
+
+        // A single placed stone can be completed exactly if some solution contains it
+        size_t feasible = 0;
+        size_t infeasible = 0;
+        for (auto const &stone : stones) {
+            for (size_t cell = 0; cell < 16; ++cell) {
+                for (auto const horizontal : {false, true}) {
+                    Solution placed;
+                    placed.push_back({{stone.fields.size(), cell / 4, cell % 4, horizontal, false}, stone});
+                    auto const hint = PartialSolver(stones, placed).find();
+                    if (!hint.reason.empty()) {
+                        continue;
+                    }
+                    VERIFY(hint.complete);
+                    VERIFY(hint.nodes < nodes);
+                    bool const expected = any_of(solutions.begin(), solutions.end(), [&](const Solution &solution) {
+                        return contains(solution, placed.front());
+                    });
+                    VERIFY_EQUAL(expected, hint.feasible);
+                    if (hint.feasible) {
+                        ++feasible;
+                        auto board = placed;
+                        board.insert(board.end(), hint.placements.begin(), hint.placements.end());
+                        VERIFY(Board(4, board).isValid());
+                        VERIFY(Board(4, board).isFull());
+                        // The next placement covers the first empty cell
+                        auto const &next = hint.placements.front().first;
+                        size_t const empty = cell > 0 ? 0 : (horizontal ? stone.fields.size() : 1);
+                        VERIFY_EQUAL(empty, next.row * 4 + next.col);
+                    } else {
+                        ++infeasible;
+                    }
+                }
+            }
+        }
+        VERIFY(feasible > 0);
+        VERIFY(infeasible > 0);
+
+        auto const solution = solutions.front();
+        auto const none = PartialSolver(stones, Solution()).find();
+        VERIFY(none.feasible);
+        VERIFY_EQUAL(solution.size(), none.placements.size());
+        auto const all = PartialSolver(stones, solution).find();
+        VERIFY(all.feasible);
+        VERIFY(all.placements.empty());
+
+        Solution twice;
+        twice.push_back({{2, 0, 0, true, false}, Stone("GB")});
+        twice.push_back({{2, 1, 0, true, false}, Stone("BG")});
+        auto const duplicate = PartialSolver(stones, twice).find();
+        VERIFY(!duplicate.feasible);
+        VERIFY(!duplicate.reason.empty());
+    }
+
+private:
+    static bool contains(const Solution &solution, const Solution::value_type &placement)
+    {
+        for (auto const &placed : solution) {
+            auto const &position = placed.first;
+            auto fields = placed.second.fields;
+            if (position.reverse) {
+                reverse(fields.begin(), fields.end());
+            }
+            if (position.row == placement.first.row && position.col == placement.first.col &&
+                position.size == placement.first.size && position.horizontal == placement.first.horizontal &&
+                fields == placement.second.fields) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+class Caching
+{
+public:
+    Caching()
+    {
+        auto const stones = mediumStones();
+        // Colors renamed (G to R, R to D, D to G), stones reordered and some reversed
+        Stones renamed;
+        renamed << "GD" << "DGB" << "BR" << "GBR" << "RDG" << "DRB";
+        VERIFY_EQUAL(CanonicalStones(stones).key(), CanonicalStones(renamed).key());
+        Stones other;
+        other << "GBD" << "RGB" << "DRG" << "RDB" << "GD" << "BR";
+        VERIFY(CanonicalStones(stones).key() != CanonicalStones(other).key());
+
+        Solutions solutions;
+        for (auto const &layout : LayoutGenerator::findAll(stones)) {
+            auto const found = Solver(layout, stones).findAssignment();
+            solutions.insert(solutions.end(), found.begin(), found.end());
+        }
+        VERIFY(!solutions.empty());
+
+        ResultCache cache;
+        size_t count = 0;
+        Solutions translated;
+        VERIFY(!cache.find(CanonicalStones(renamed), count, translated));
+        cache.insert(CanonicalStones(stones), solutions);
+        VERIFY(cache.find(CanonicalStones(renamed), count, translated));
+        VERIFY_EQUAL(solutions.size(), count);
+        VERIFY_EQUAL(solutions.size(), translated.size());
+        set<string> values;
+        for (auto const &stone : renamed) {
+            values.insert(stone.value());
+        }
+        for (auto const &solution : translated) {
+            Board const board(4, solution);
+            VERIFY(board.isValid());
+            VERIFY(board.isFull());
+            for (auto const &placement : solution) {
+                VERIFY(values.count(placement.second.value()));
+            }
+        }
+        VERIFY(cache.find(CanonicalStones(stones), count, translated, 1));
+        VERIFY_EQUAL(solutions.size(), count);
+        VERIFY_EQUAL(1, translated.size());
+        VERIFY_EQUAL(Board(4, solutions.front()).signature(), Board(4, translated.front()).signature());
+
+        string const file = "test-five-colors-cache.txt";
+        ResultCache saved(file);
+        saved.insert(CanonicalStones(stones), solutions);
+        VERIFY(saved.save());
+        ResultCache const loaded(file);
+        VERIFY_EQUAL(1, loaded.size());
+        VERIFY(loaded.error().empty());
+        VERIFY(loaded.find(CanonicalStones(renamed), count, translated));
+        VERIFY_EQUAL(solutions.size(), count);
+        VERIFY(!loaded.find(CanonicalStones(other), count, translated));
+
+        // A stone moved off the board makes the whole file a miss
+        stringstream content;
+        content << ifstream(file).rdbuf();
+        auto text = content.str();
+        auto const row = text.find(' ', text.find('\n', text.find("solutions ")) + 1) + 1;
+        text.replace(row, 1, "9");
+        ofstream(file) << text;
+        ResultCache const damaged(file);
+        remove(file.c_str());
+        VERIFY_EQUAL(0, damaged.size());
+        VERIFY(!damaged.error().empty());
+        VERIFY(ResultCache(file).error().empty());
+    }
+};
+
+// The smallest signature among the rotated and mirrored boards
+static string canonical(string signature, size_t size)
+{
+    auto result = signature;
+    for (int flip = 0; flip < 2; ++flip) {
+        for (int i = 0; i < 4; ++i) {
+            string rotated = signature;
+            for (size_t row = 0; row < size; ++row) {
+                for (size_t col = 0; col < size; ++col) {
+                    rotated[col * size + size - 1 - row] = signature[row * size + col];
+                }
+            }
+            signature = rotated;
+            result = min(result, signature);
+        }
+        for (size_t row = 0; row < size; ++row) {
+            reverse(signature.begin() + long(row * size), signature.begin() + long((row + 1) * size));
+        }
+    }
+    return result;
+}
+
+class LatinSquares
+{
+public:
+    LatinSquares()
+    {
+        // Known numbers of reduced Latin squares
+        VERIFY_EQUAL(1, LatinSolver::reducedSquares(3).size());
+        VERIFY_EQUAL(4, LatinSolver::reducedSquares(4).size());
+        VERIFY_EQUAL(56, LatinSolver::reducedSquares(5).size());
+
+        // Both engines find the same boards, up to rotation and mirroring
+        for (auto const &values : vector<vector<string>>({{"GBD", "RGB", "DRG", "RDB", "GB", "DR"},
+                                                          {"DR", "GB", "BYR", "YDG", "RGY", "BGY", "DYR", "DRB", "GBD"}})) {
+            Stones stones;
+            for (auto const &value : values) {
+                stones << value;
+            }
+            size_t const size = values.size() == 6 ? 4 : 5;
+            set<string> expected;
+            for (auto const &layout : LayoutGenerator::findAll(stones)) {
+                for (auto const &solution : Solver(layout, stones).findAssignment()) {
+                    expected.insert(canonical(Board(size, solution).signature(), size));
+                }
+            }
+            set<string> found;
+            set<string> boards;
+            auto const count = LatinSolver(stones).findBoards([&](const Solution &solution) {
+                Board const board(size, solution);
+                VERIFY(board.isValid());
+                VERIFY(board.isFull());
+                boards.insert(board.signature());
+                found.insert(canonical(board.signature(), size));
+            });
+            VERIFY(!expected.empty());
+            VERIFY(expected == found);
+            VERIFY_EQUAL(boards.size(), count);
+        }
+
+        Stones large;
+        large << "GR" << "YV" << "RB" << "DYV" << "BGR" << "VDY" << "BDG" << "YDV" << "RGB" << "VGDB" << "YBVR" << "DRYG";
+        VERIFY_EQUAL(0, LatinSolver(large).findBoards([](const Solution &) {}));
+        VERIFY(!LatinSolver(large).error().empty());
+
+        // Stones that do not fit the board are refused before cutting anything
+        Stones longest;
+        longest << "GRBYDVG" << "RB" << "YD" << "BG" << "DR" << "GY" << "VB" << "RV" << "YGRB";
+        VERIFY_EQUAL(string("Stone GRBYDVG is longer than the board."), LatinSolver(longest).error());
+        VERIFY_EQUAL(0, LatinSolver(longest).findBoards([](const Solution &) {}));
+        Stones partial;
+        partial << "GBD" << "RGB";
+        VERIFY(!LatinSolver(partial).error().empty());
+        Stones small;
+        small << "RGB" << "GBR" << "BRG";
+        VERIFY(LatinSolver(small).error().empty());
+    }
+};
+
+class InlineStones
+{
+public:
+    InlineStones()
+    {
+        static_assert(is_trivially_copyable<Stone>::value, "Stones are copied without allocating");
+
+        Stone const stone("GRBY");
+        VERIFY_EQUAL(4, stone.fields.size());
+        VERIFY_EQUAL(string("GRBY"), stone.value());
+        VERIFY_EQUAL(string("YBRG"), string(stone.reversed.begin(), stone.reversed.end()));
+        VERIFY(stone.fields != stone.reversed);
+        VERIFY(Stone("YBRG").fields == stone.reversed);
+        VERIFY(Stone("GRBY") == stone);
+        VERIFY(!(Stone("GRB") == stone));
+        ColorMask mask = 0;
+        for (auto const color : stone.value()) {
+            mask |= ColorMask(1) << Palette::id(color);
+        }
+        VERIFY_EQUAL(mask, stone.colors);
+
+        Stone const longest(string(Stone::maxSize, 'G'));
+        VERIFY_EQUAL(Stone::maxSize, longest.value().size());
+        // Longer stones are refused instead of becoming different ones
+        bool refused = false;
+        try {
+            Stone(string(Stone::maxSize + 1, 'G'));
+        } catch (const length_error &) {
+            refused = true;
+        }
+        VERIFY(refused);
+        vector<size_t> tooLong(Stone::maxSize + 2, 0);
+        tooLong[Stone::maxSize + 1] = Stone::maxSize + 1;
+        VERIFY(LayoutGenerator::findAll(tooLong).empty());
+
+        // Copying stones never touches the heap
+        Stones stones;
+        stones << "GR" << "RGB" << "BRG";
+        auto const allocations = Memory::allocations();
+        Stone copies[3] = {stones.front(), *next(stones.begin()), stones.back()};
+        VERIFY_EQUAL(allocations, Memory::allocations());
+        VERIFY(copies[2] == stones.back());
+    }
+};
+
+class Builtin
+{
+public:
+    Builtin()
+    {
+        // Solved by the compiler
+        constexpr BuiltinSolver<3, 3> small({"RGB", "GBR", "BRG"});
+        constexpr auto small_result = small.solve();
+        static_assert(small_result.count == 6, "The small game has six solutions");
+        static_assert(small.verify(small_result), "The small game solution is valid");
+        constexpr BuiltinSolver<4, 6> medium({"GBD", "RGB", "DRG", "RDB", "GB", "DR"});
+        constexpr auto medium_result = medium.solve();
+        static_assert(medium_result.count == 80, "The medium game has 80 solutions");
+        static_assert(medium.verify(medium_result), "The medium game solution is valid");
+        static_assert(!BuiltinSolver<3, 3>({"RGB", "GBR", "BRR"}).solve().count, "Repeated colors have no solution");
+        static_assert(!BuiltinSolver<3, 2>({"RGB", "GBR"}).solve().count, "Uncovered cells have no solution");
+
+        // The answer built into solve-five-colors
+        BuiltinSolver<5, 9> const five_colors({"DRB", "RDG", "GYR", "YBD", "BGY", "BGD", "RDY", "YR", "GB"});
+        auto const result = five_colors.solve();
+        VERIFY_EQUAL(1, result.count);
+        VERIFY_EQUAL(string("BGYDRRYBGDDRGBYYBDRGGDRYB"), string(result.cells));
+        VERIFY(five_colors.verify(result));
+        auto wrong = result;
+        swap(wrong.cells[0], wrong.cells[1]);
+        VERIFY(!five_colors.verify(wrong));
+        wrong = result;
+        wrong.placements[1].reverse = !wrong.placements[1].reverse;
+        VERIFY(!five_colors.verify(wrong));
+        Board const board(5, five_colors.solution(result));
+        VERIFY(board.isValid());
+        VERIFY_EQUAL(string(result.cells), board.signature());
+
+        // The same boards as the runtime solver, up to rotation and mirroring
+        VERIFY(boards(small) == runtimeBoards({"RGB", "GBR", "BRG"}, 3));
+        VERIFY(boards(medium) == runtimeBoards({"GBD", "RGB", "DRG", "RDB", "GB", "DR"}, 4));
+        VERIFY(boards(five_colors) == runtimeBoards({"DRB", "RDG", "GYR", "YBD", "BGY", "BGD", "RDY", "YR", "GB"}, 5));
+        BuiltinSolver<5, 9> const many({"DR", "GB", "BYR", "YDG", "RGY", "BGY", "DYR", "DRB", "GBD"});
+        VERIFY(boards(many) == runtimeBoards({"DR", "GB", "BYR", "YDG", "RGY", "BGY", "DYR", "DRB", "GBD"}, 5));
+    }
+
+private:
+    template <size_t Size, size_t Count>
+    static set<string> boards(const BuiltinSolver<Size, Count> &solver)
+    {
+        set<string> result;
+        solver.forEach([&result](const typename BuiltinSolver<Size, Count>::State &state) {
+            result.insert(string(state.cells, Size * Size));
+        });
+        return result;
+    }
+
+    static set<string> runtimeBoards(const vector<string> &values, size_t size)
+    {
+        Stones stones;
+        for (auto const &value : values) {
+            stones << value;
+        }
+        set<string> result;
+        for (auto const &layout : LayoutGenerator::findAll(stones)) {
+            for (auto const &solution : Solver(layout, stones).findAssignment()) {
+                result.insert(canonical(Board(size, solution).signature(), size));
+            }
+        }
+        return result;
+    }
+};
+
+class HardwareCounters
+{
+public:
+    HardwareCounters()
+    {
+        Counters::Values values;
+        values.counts[Counters::Cycles] = 100;
+        values.counts[Counters::Instructions] = 250;
+        values.measured[Counters::Cycles] = true;
+        values.measured[Counters::Instructions] = true;
+        VERIFY_EQUAL(2.5, values.ratio(Counters::Instructions, Counters::Cycles));
+        VERIFY_EQUAL(25, values.per(Counters::Instructions, 10));
+        VERIFY(values.ratio(Counters::BranchMisses, Counters::Cycles) < 0);
+        VERIFY(values.per(Counters::L1Misses, 10) < 0);
+        VERIFY(values.per(Counters::Instructions, 0) < 0);
+        VERIFY_EQUAL(string("LLC misses"), string(Counters::name(Counters::LLCMisses)));
+
+        // Many machines, e.g. virtual ones, have no counters. Measuring still works, but yields nothing.
+        Counters counters;
+        VERIFY(counters.available() == counters.error().empty());
+        counters.start();
+        auto const layouts = LayoutGenerator::findAll(vector<size_t>({0, 2, 7}));
+        auto const measured = counters.stop();
+        VERIFY(!layouts.empty());
+        bool any = false;
+        for (auto const flag : measured.measured) {
+            any = any || flag;
+        }
+        VERIFY(any || !counters.available());
+    }
+};
+
 int main()
 {
     SmallGame small_game;
     MediumGame medium_game;
     LargeGame large_game;
     Variants variants;
+    LayoutCounting layout_counting;
+    Iteration iteration;
+    Resumption resumption;
+    Budgets budgets;
+    Colors colors;
+    Sharding sharding;
+    Feasibility feasibility;
+    Output output;
+    Storage storage;
+    Filtering filtering;
+    Trie trie;
+    Tracing tracing;
+    Restarts restarts;
+    Parallel parallel;
+    Streaming streaming;
+    Allocations allocations;
+    Estimation estimation;
+    Switching switching;
+    Hints hints;
+    Caching caching;
+    LatinSquares latin_squares;
+    InlineStones inline_stones;
+    Builtin builtin;
+    HardwareCounters hardware_counters;
 }
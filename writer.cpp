@@ -0,0 +1,169 @@
+// Copyright 2018 Dennis Nienhüser
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "writer.h"
+#include "memory.h"
+#include "trace.h"
+
+using namespace std;
+
+static char const binaryMagic[4] = {'5', 'C', 'S', '1'};
+
+SolutionWriter::SolutionWriter(ostream &stream, Format format, size_t bufferSize) :
+    stream_(stream), format_(format), capacity_(bufferSize)
+{
+    buffer_.reserve(capacity_);
+}
+
+SolutionWriter::~SolutionWriter()
+{
+    flush();
+}
+
+void SolutionWriter::resume(size_t boardSize)
+{
+    assert(count_ == 0);
+    boardSize_ = boardSize;
+}
+
+void SolutionWriter::write(size_t boardSize, const Solution &solution)
+{
+    MemoryPhase phase(Memory::Output);
+    if (format_ == Format::Binary && boardSize_ != boardSize) {
+        // The header determines the record size, so all boards written need to be of the same size
+        assert(count_ == 0);
+        buffer_.append(binaryMagic, sizeof(binaryMagic));
+        for (int i = 0; i < 4; ++i) {
+            buffer_ += char((boardSize >> (8 * i)) & 0xFF);
+        }
+    }
+    boardSize_ = boardSize;
+
+    cells_.assign(boardSize * boardSize, ' ');
+    for (auto const &assignment : solution) {
+        auto const &position = assignment.first;
+        size_t row = position.row;
+        size_t col = position.col;
+        for (auto const value : position.reverse ? assignment.second.reversed : assignment.second.fields) {
+            cells_[row * boardSize + col] = value;
+            row += position.horizontal ? 0 : 1;
+            col += position.horizontal ? 1 : 0;
+        }
+    }
+
+    switch (format_) {
+    case Format::Text:
+        reserve(cells_.size() + 1);
+        buffer_ += cells_;
+        buffer_ += '\n';
+        break;
+    case Format::Jsonl:
+        reserve(cells_.size() + 64 * solution.size() + 32);
+        buffer_ += "{\"board\":\"";
+        buffer_ += cells_;
+        buffer_ += "\",\"stones\":[";
+        for (auto const &assignment : solution) {
+            auto const &position = assignment.first;
+            auto const &fields = position.reverse ? assignment.second.reversed : assignment.second.fields;
+            buffer_ += buffer_.back() == '[' ? "{\"row\":" : ",{\"row\":";
+            appendNumber(position.row);
+            buffer_ += ",\"col\":";
+            appendNumber(position.col);
+            buffer_ += position.horizontal ? ",\"horizontal\":true,\"colors\":\"" : ",\"horizontal\":false,\"colors\":\"";
+            buffer_.append(fields.begin(), fields.end());
+            buffer_ += "\"}";
+        }
+        buffer_ += "]}\n";
+        break;
+    case Format::Binary:
+        reserve(cells_.size());
+        for (auto cell : cells_) {
+            buffer_ += char(Palette::id(cell));
+        }
+        break;
+    }
+    ++count_;
+}
+
+void SolutionWriter::flush()
+{
+    TraceSpan span("SolutionWriter::flush");
+    MemoryPhase phase(Memory::Output);
+    if (!buffer_.empty()) {
+        stream_.write(buffer_.data(), streamsize(buffer_.size()));
+        bytes_ += buffer_.size();
+        buffer_.clear();
+    }
+    stream_.flush();
+}
+
+size_t SolutionWriter::count() const
+{
+    return count_;
+}
+
+uint64_t SolutionWriter::bytes() const
+{
+    return bytes_;
+}
+
+bool SolutionWriter::parse(const string &name, Format &format)
+{
+    if (name == "text") {
+        format = Format::Text;
+    } else if (name == "jsonl") {
+        format = Format::Jsonl;
+    } else if (name == "binary") {
+        format = Format::Binary;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void SolutionWriter::reserve(size_t bytes)
+{
+    if (buffer_.size() + bytes > capacity_ && !buffer_.empty()) {
+        stream_.write(buffer_.data(), streamsize(buffer_.size()));
+        bytes_ += buffer_.size();
+        buffer_.clear();
+    }
+}
+
+void SolutionWriter::appendNumber(size_t value)
+{
+    char digits[20];
+    size_t length = 0;
+    do {
+        digits[length++] = char('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+    while (length > 0) {
+        buffer_ += digits[--length];
+    }
+}
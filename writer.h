@@ -0,0 +1,81 @@
+// Copyright 2018 Dennis Nienhüser
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef WRITER_H
+#define WRITER_H
+
+#include "puzzle.h"
+
+#include <ostream>
+#include <string>
+
+// Writes solutions to a stream in bulk. Solutions are formatted into a large buffer that is reused, and
+// the stream only sees complete chunks of it.
+class SolutionWriter
+{
+public:
+    enum class Format {
+        // One line per board with its signature
+        Text,
+        // One JSON object per line with the board signature and the placed stones
+        Jsonl,
+        // A header with a magic number and the board size, followed by one record per board with the
+        // palette identifier of each cell, row by row
+        Binary
+    };
+
+    SolutionWriter(std::ostream &stream, Format format, size_t bufferSize = 1 << 20);
+    ~SolutionWriter();
+
+    // The stream continues output of an earlier run, which has the binary header for boards of the size
+    // already
+    void resume(size_t boardSize);
+    void write(size_t boardSize, const Solution &solution);
+    void flush();
+    size_t count() const;
+    // Bytes passed to the stream so far
+    uint64_t bytes() const;
+
+    static bool parse(const std::string &name, Format &format);
+
+private:
+    void reserve(size_t bytes);
+    void appendNumber(size_t value);
+
+    std::ostream &stream_;
+    Format format_;
+    std::string buffer_;
+    size_t capacity_;
+    // The board of the current solution, reused to avoid allocations
+    std::string cells_;
+    size_t boardSize_ = 0;
+    size_t count_ = 0;
+    uint64_t bytes_ = 0;
+};
+
+#endif